@@ -0,0 +1,37 @@
+
+// The S2 library sources in src/s2 route output, aborts, and random numbers
+// through cpp-compat.h so that the package can redirect them to R. Outside
+// of R they go to the standard library.
+
+#include "cpp-compat.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+void cpp_compat_printf(const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  std::vprintf(fmt, args);
+  va_end(args);
+}
+
+void cpp_compat_abort() {
+  std::abort();
+}
+
+void cpp_compat_exit(int code) {
+  std::exit(code);
+}
+
+int cpp_compat_random() {
+  return std::rand();
+}
+
+void cpp_compat_srandom(int seed) {
+  std::srand(seed);
+}
+
+std::ostream& cpp_compat_cerr = std::cerr;
+std::ostream& cpp_compat_cout = std::cout;
@@ -0,0 +1,783 @@
+
+#ifndef BENCH_DATA_H
+#define BENCH_DATA_H
+
+#include <bzlib.h>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s1angle.h"
+#include "s2/s2cell.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2latlng.h"
+#include "s2/s2loop.h"
+#include "s2/s2point_vector_shape.h"
+#include "s2/s2polygon.h"
+#include "s2/s2polyline.h"
+#include "s2/third_party/absl/memory/memory.h"
+
+#include "../src/s2-random.h"
+
+// A feature as the package represents it (see PointGeography,
+// PolylineGeography, and PolygonGeography in src/), without the R
+// dependencies of the Geography classes.
+struct Feature {
+  std::vector<S2Point> points;
+  std::vector<std::unique_ptr<S2Polyline>> polylines;
+  std::unique_ptr<S2Polygon> polygon;
+
+  // Adds shapes the way Geography::BuildShapeIndex() does
+  void BuildShapeIndex(MutableS2ShapeIndex* index) const {
+    if (!this->points.empty()) {
+      std::vector<S2Point> pointsCopy(this->points);
+      index->Add(absl::make_unique<S2PointVectorShape>(std::move(pointsCopy)));
+    }
+
+    for (const auto& polyline: this->polylines) {
+      auto shape = absl::make_unique<S2Polyline::Shape>();
+      shape->Init(polyline.get());
+      index->Add(std::move(shape));
+    }
+
+    if (this->polygon) {
+      auto shape = absl::make_unique<S2Polygon::Shape>();
+      shape->Init(this->polygon.get());
+      index->Add(std::move(shape));
+    }
+  }
+
+  int NumVertices() const {
+    int n = this->points.size();
+    for (const auto& polyline: this->polylines) {
+      n += polyline->num_vertices();
+    }
+
+    if (this->polygon) {
+      n += this->polygon->num_vertices();
+    }
+
+    return n;
+  }
+};
+
+typedef std::vector<std::unique_ptr<Feature>> FeatureVector;
+
+// -------- reading the package's data/*.rda files ----------
+
+// The subset of R's serialization format (version 2, XDR) needed to read a
+// data frame of character, numeric, and wk_wkb columns saved using save().
+struct RValue {
+  int type = 0;
+  std::vector<std::string> strings;
+  std::vector<bool> stringIsNA;
+  std::vector<double> reals;
+  std::vector<int> ints;
+  std::vector<unsigned char> raw;
+  std::vector<std::shared_ptr<RValue>> items;
+  // tags of pairlist items (a pairlist is flattened into items)
+  std::vector<std::string> tags;
+  std::shared_ptr<RValue> attributes;
+
+  std::shared_ptr<RValue> Attribute(const std::string& name) const {
+    if (!this->attributes) {
+      return nullptr;
+    }
+
+    for (size_t i = 0; i < this->attributes->tags.size(); i++) {
+      if (this->attributes->tags[i] == name) {
+        return this->attributes->items[i];
+      }
+    }
+
+    return nullptr;
+  }
+
+  // for data frames (lists with names)
+  std::shared_ptr<RValue> Column(const std::string& name) const {
+    std::shared_ptr<RValue> names = this->Attribute("names");
+    for (size_t i = 0; names && i < names->strings.size(); i++) {
+      if (names->strings[i] == name) {
+        return this->items[i];
+      }
+    }
+
+    throw std::runtime_error("Column '" + name + "' not found");
+  }
+};
+
+class RDataReader {
+public:
+  RDataReader(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      throw std::runtime_error("Can't open '" + path + "'");
+    }
+
+    std::string compressed((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    this->data = decompress(compressed);
+  }
+
+  // the objects in the file by name
+  std::shared_ptr<RValue> Read() {
+    if (this->data.compare(0, 7, "RDX2\nX\n") != 0) {
+      throw std::runtime_error("Expected an .rda file in version 2 XDR format");
+    }
+
+    this->offset = 7;
+    this->readInt(); // version
+    this->readInt(); // writer version
+    this->readInt(); // minimum reader version
+    return this->readItem();
+  }
+
+private:
+  enum {
+    NILSXP = 0, SYMSXP = 1, LISTSXP = 2, LGLSXP = 10, INTSXP = 13,
+    REALSXP = 14, STRSXP = 16, VECSXP = 19, RAWSXP = 24, CHARSXP = 9,
+    REFSXP = 255, NILVALUE_SXP = 254, GLOBALENV_SXP = 253,
+    EMPTYENV_SXP = 242, BASEENV_SXP = 241
+  };
+
+  std::string data;
+  size_t offset = 0;
+  std::vector<std::shared_ptr<RValue>> refs;
+
+  static std::string decompress(const std::string& compressed) {
+    if (compressed.compare(0, 3, "BZh") != 0) {
+      return compressed;
+    }
+
+    bz_stream stream;
+    std::memset(&stream, 0, sizeof(bz_stream));
+    if (BZ2_bzDecompressInit(&stream, 0, 0) != BZ_OK) {
+      throw std::runtime_error("Can't initialize bzip2 decompression");
+    }
+
+    std::string out;
+    char buffer[65536];
+    stream.next_in = const_cast<char*>(compressed.data());
+    stream.avail_in = compressed.size();
+    int status = BZ_OK;
+    while (status == BZ_OK) {
+      stream.next_out = buffer;
+      stream.avail_out = sizeof(buffer);
+      status = BZ2_bzDecompress(&stream);
+      out.append(buffer, sizeof(buffer) - stream.avail_out);
+    }
+
+    BZ2_bzDecompressEnd(&stream);
+    if (status != BZ_STREAM_END) {
+      throw std::runtime_error("Can't decompress bzip2 data");
+    }
+
+    return out;
+  }
+
+  void check(size_t n) {
+    if (this->offset + n > this->data.size()) {
+      throw std::runtime_error("Unexpected end of serialized data");
+    }
+  }
+
+  int readInt() {
+    this->check(4);
+    const unsigned char* p = reinterpret_cast<const unsigned char*>(this->data.data() + this->offset);
+    this->offset += 4;
+    return static_cast<int>(
+      (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3])
+    );
+  }
+
+  double readDouble() {
+    this->check(8);
+    uint64_t bits = 0;
+    for (int i = 0; i < 8; i++) {
+      bits = (bits << 8) | static_cast<unsigned char>(this->data[this->offset + i]);
+    }
+
+    this->offset += 8;
+    double value;
+    std::memcpy(&value, &bits, sizeof(double));
+    return value;
+  }
+
+  int64_t readLength() {
+    int length = this->readInt();
+    if (length != -1) {
+      return length;
+    }
+
+    int64_t upper = this->readInt();
+    int64_t lower = static_cast<uint32_t>(this->readInt());
+    return (upper << 32) + lower;
+  }
+
+  // returns false for NA_character_
+  bool readCharsxp(std::string* out) {
+    int length = this->readInt();
+    if (length == -1) {
+      return false;
+    }
+
+    this->check(length);
+    out->assign(this->data, this->offset, length);
+    this->offset += length;
+    return true;
+  }
+
+  std::shared_ptr<RValue> readItem() {
+    int flags = this->readInt();
+    int type = flags & 0xFF;
+    bool hasAttributes = flags & (1 << 9);
+    bool hasTag = flags & (1 << 10);
+
+    auto value = std::make_shared<RValue>();
+    value->type = type;
+
+    switch (type) {
+    case NILVALUE_SXP:
+    case GLOBALENV_SXP:
+    case EMPTYENV_SXP:
+    case BASEENV_SXP:
+      value->type = NILSXP;
+      return value;
+
+    case REFSXP: {
+      int index = flags >> 8;
+      if (index == 0) {
+        index = this->readInt();
+      }
+
+      return this->refs.at(index - 1);
+    }
+
+    case SYMSXP: {
+      int charFlags = this->readInt();
+      if ((charFlags & 0xFF) != CHARSXP) {
+        throw std::runtime_error("Expected a CHARSXP in a symbol");
+      }
+
+      std::string name;
+      this->readCharsxp(&name);
+      value->strings.push_back(name);
+      this->refs.push_back(value);
+      return value;
+    }
+
+    case LISTSXP: {
+      // read the whole pairlist iteratively
+      std::shared_ptr<RValue> attributes;
+      while (true) {
+        if (hasAttributes) {
+          attributes = this->readItem();
+        }
+
+        std::string tag;
+        if (hasTag) {
+          std::shared_ptr<RValue> symbol = this->readItem();
+          tag = symbol->strings.empty() ? "" : symbol->strings[0];
+        }
+
+        value->tags.push_back(tag);
+        value->items.push_back(this->readItem());
+
+        int nextFlags = this->readInt();
+        if ((nextFlags & 0xFF) != LISTSXP) {
+          if ((nextFlags & 0xFF) != NILVALUE_SXP) {
+            throw std::runtime_error("Expected the end of a pairlist");
+          }
+
+          break;
+        }
+
+        hasAttributes = nextFlags & (1 << 9);
+        hasTag = nextFlags & (1 << 10);
+      }
+
+      value->attributes = attributes;
+      return value;
+    }
+
+    case CHARSXP: {
+      std::string string;
+      value->stringIsNA.push_back(!this->readCharsxp(&string));
+      value->strings.push_back(string);
+      break;
+    }
+
+    case LGLSXP:
+    case INTSXP: {
+      int64_t length = this->readLength();
+      value->ints.resize(length);
+      for (int64_t i = 0; i < length; i++) {
+        value->ints[i] = this->readInt();
+      }
+      break;
+    }
+
+    case REALSXP: {
+      int64_t length = this->readLength();
+      value->reals.resize(length);
+      for (int64_t i = 0; i < length; i++) {
+        value->reals[i] = this->readDouble();
+      }
+      break;
+    }
+
+    case STRSXP: {
+      int64_t length = this->readLength();
+      for (int64_t i = 0; i < length; i++) {
+        this->readInt(); // CHARSXP flags
+        std::string string;
+        value->stringIsNA.push_back(!this->readCharsxp(&string));
+        value->strings.push_back(string);
+      }
+      break;
+    }
+
+    case VECSXP: {
+      int64_t length = this->readLength();
+      for (int64_t i = 0; i < length; i++) {
+        value->items.push_back(this->readItem());
+      }
+      break;
+    }
+
+    case RAWSXP: {
+      int64_t length = this->readLength();
+      this->check(length);
+      value->raw.assign(this->data.begin() + this->offset, this->data.begin() + this->offset + length);
+      this->offset += length;
+      break;
+    }
+
+    default:
+      std::stringstream err;
+      err << "Can't read serialized R object of type " << type;
+      throw std::runtime_error(err.str());
+    }
+
+    if (hasAttributes) {
+      value->attributes = this->readItem();
+    }
+
+    return value;
+  }
+};
+
+// -------- well-known binary ----------
+
+// Reads WKB (ISO or EWKB) into features the way the package's geography
+// builders do: coordinates are normalized longitude/latitude, the closing
+// vertex of each ring is dropped, loops are normalized (i.e., oriented =
+// FALSE), and all the loops of a feature form one S2Polygon (InitNested()).
+class WKBFeatureReader {
+public:
+  WKBFeatureReader(bool check = true): check(check) {}
+
+  std::unique_ptr<Feature> Read(const unsigned char* data, size_t size) {
+    this->data = data;
+    this->size = size;
+    this->offset = 0;
+    this->loops.clear();
+
+    auto feature = absl::make_unique<Feature>();
+    this->readGeometry(feature.get());
+
+    if (!this->loops.empty()) {
+      feature->polygon = absl::make_unique<S2Polygon>();
+      feature->polygon->set_s2debug_override(S2Debug::DISABLE);
+      feature->polygon->InitNested(std::move(this->loops));
+      if (this->check && !feature->polygon->IsValid()) {
+        throw std::runtime_error("Invalid polygon");
+      }
+    }
+
+    return feature;
+  }
+
+private:
+  bool check;
+  const unsigned char* data;
+  size_t size;
+  size_t offset;
+  bool swap;
+  std::vector<std::unique_ptr<S2Loop>> loops;
+
+  uint32_t readUInt32() {
+    if (this->offset + 4 > this->size) {
+      throw std::runtime_error("Unexpected end of WKB");
+    }
+
+    uint32_t value;
+    std::memcpy(&value, this->data + this->offset, 4);
+    this->offset += 4;
+    if (this->swap) {
+      value = __builtin_bswap32(value);
+    }
+
+    return value;
+  }
+
+  double readDouble() {
+    if (this->offset + 8 > this->size) {
+      throw std::runtime_error("Unexpected end of WKB");
+    }
+
+    uint64_t bits;
+    std::memcpy(&bits, this->data + this->offset, 8);
+    this->offset += 8;
+    if (this->swap) {
+      bits = __builtin_bswap64(bits);
+    }
+
+    double value;
+    std::memcpy(&value, &bits, 8);
+    return value;
+  }
+
+  std::vector<S2Point> readCoords(uint32_t n, int nDims, bool dropLast) {
+    std::vector<S2Point> points;
+    points.reserve(n);
+    for (uint32_t i = 0; i < n; i++) {
+      double x = this->readDouble();
+      double y = this->readDouble();
+      for (int j = 2; j < nDims; j++) {
+        this->readDouble();
+      }
+
+      if (!dropLast || i + 1 < n) {
+        points.push_back(S2LatLng::FromDegrees(y, x).Normalized().ToPoint());
+      }
+    }
+
+    return points;
+  }
+
+  void readGeometry(Feature* feature) {
+    if (this->offset >= this->size) {
+      throw std::runtime_error("Unexpected end of WKB");
+    }
+
+    this->swap = (this->data[this->offset++] == 0x00) == isLittleEndian();
+    uint32_t typeCode = this->readUInt32();
+
+    bool hasZ = typeCode & 0x80000000;
+    bool hasM = typeCode & 0x40000000;
+    if (typeCode & 0x20000000) {
+      this->readUInt32(); // srid
+    }
+
+    typeCode &= 0x0000ffff;
+    hasZ = hasZ || (typeCode / 1000) == 1 || (typeCode / 1000) == 3;
+    hasM = hasM || (typeCode / 1000) == 2 || (typeCode / 1000) == 3;
+    int nDims = 2 + hasZ + hasM;
+
+    switch (typeCode % 1000) {
+    case 1: {
+      std::vector<S2Point> point = this->readCoords(1, nDims, false);
+      S2LatLng ll(point[0]);
+      if (!std::isnan(ll.lat().degrees())) {
+        feature->points.push_back(point[0]);
+      }
+      break;
+    }
+
+    case 2: {
+      std::vector<S2Point> points = this->readCoords(this->readUInt32(), nDims, false);
+      auto polyline = absl::make_unique<S2Polyline>();
+      polyline->set_s2debug_override(S2Debug::DISABLE);
+      polyline->Init(points);
+      if (this->check && !polyline->IsValid()) {
+        throw std::runtime_error("Invalid polyline");
+      }
+      feature->polylines.push_back(std::move(polyline));
+      break;
+    }
+
+    case 3: {
+      uint32_t nRings = this->readUInt32();
+      for (uint32_t i = 0; i < nRings; i++) {
+        std::vector<S2Point> vertices = this->readCoords(this->readUInt32(), nDims, true);
+        auto loop = absl::make_unique<S2Loop>();
+        loop->set_s2debug_override(S2Debug::DISABLE);
+        loop->Init(vertices);
+        loop->Normalize();
+        if (this->check && !loop->IsValid()) {
+          throw std::runtime_error("Invalid loop");
+        }
+        this->loops.push_back(std::move(loop));
+      }
+      break;
+    }
+
+    case 4:
+    case 5:
+    case 6:
+    case 7: {
+      uint32_t nParts = this->readUInt32();
+      for (uint32_t i = 0; i < nParts; i++) {
+        this->readGeometry(feature);
+      }
+      break;
+    }
+
+    default:
+      throw std::runtime_error("Unsupported WKB geometry type");
+    }
+  }
+
+  static bool isLittleEndian() {
+    const uint16_t x = 1;
+    return *reinterpret_cast<const unsigned char*>(&x) == 1;
+  }
+};
+
+// Writes little-endian WKB the way the package exports geographies (a
+// polygon is written as a MULTIPOLYGON if it has more than one outer loop).
+class WKBFeatureWriter {
+public:
+  std::vector<unsigned char> Write(const Feature& feature) {
+    this->buffer.clear();
+
+    int nParts = (feature.points.size() > 0) + (feature.polylines.size() > 0) +
+      (feature.polygon != nullptr);
+    if (nParts > 1) {
+      this->writeHeader(7);
+      this->writeUInt32(nParts);
+    }
+
+    if (feature.points.size() == 1) {
+      this->writeHeader(1);
+      this->writePoint(feature.points[0]);
+    } else if (feature.points.size() > 1) {
+      this->writeHeader(4);
+      this->writeUInt32(feature.points.size());
+      for (const S2Point& point: feature.points) {
+        this->writeHeader(1);
+        this->writePoint(point);
+      }
+    }
+
+    if (feature.polylines.size() == 1) {
+      this->writeLinestring(*feature.polylines[0]);
+    } else if (feature.polylines.size() > 1) {
+      this->writeHeader(5);
+      this->writeUInt32(feature.polylines.size());
+      for (const auto& polyline: feature.polylines) {
+        this->writeLinestring(*polyline);
+      }
+    }
+
+    if (feature.polygon) {
+      this->writePolygon(*feature.polygon);
+    }
+
+    return this->buffer;
+  }
+
+private:
+  std::vector<unsigned char> buffer;
+
+  void writeUInt32(uint32_t value) {
+    unsigned char bytes[4];
+    std::memcpy(bytes, &value, 4);
+    this->buffer.insert(this->buffer.end(), bytes, bytes + 4);
+  }
+
+  void writeDouble(double value) {
+    unsigned char bytes[8];
+    std::memcpy(bytes, &value, 8);
+    this->buffer.insert(this->buffer.end(), bytes, bytes + 8);
+  }
+
+  void writeHeader(uint32_t typeCode) {
+    this->buffer.push_back(0x01);
+    this->writeUInt32(typeCode);
+  }
+
+  void writePoint(const S2Point& point) {
+    S2LatLng ll(point);
+    this->writeDouble(ll.lng().degrees());
+    this->writeDouble(ll.lat().degrees());
+  }
+
+  void writeLinestring(const S2Polyline& polyline) {
+    this->writeHeader(2);
+    this->writeUInt32(polyline.num_vertices());
+    for (int i = 0; i < polyline.num_vertices(); i++) {
+      this->writePoint(polyline.vertex(i));
+    }
+  }
+
+  // holes follow their shell in S2Polygon's loop order
+  void writePolygon(const S2Polygon& polygon) {
+    std::vector<std::vector<int>> rings;
+    for (int i = 0; i < polygon.num_loops(); i++) {
+      if (polygon.loop(i)->depth() % 2 == 0 || rings.empty()) {
+        rings.push_back(std::vector<int>());
+      }
+      rings.back().push_back(i);
+    }
+
+    if (rings.size() > 1) {
+      this->writeHeader(6);
+      this->writeUInt32(rings.size());
+    }
+
+    for (const auto& ring: rings) {
+      this->writeHeader(3);
+      this->writeUInt32(ring.size());
+      for (int loopId: ring) {
+        const S2Loop* loop = polygon.loop(loopId);
+        bool reverse = loop->is_hole();
+        this->writeUInt32(loop->num_vertices() + 1);
+        for (int j = 0; j <= loop->num_vertices(); j++) {
+          int k = reverse ? (loop->num_vertices() - j) : j;
+          this->writePoint(loop->vertex(k));
+        }
+      }
+    }
+  }
+};
+
+// -------- datasets ----------
+
+struct Dataset {
+  std::string name;
+  std::vector<std::vector<unsigned char>> wkb;
+  FeatureVector features;
+};
+
+// Reads the geometry column of one of the package's s2_data_tbl_* objects
+inline std::unique_ptr<Dataset> readPackageData(const std::string& dataDir, const std::string& name) {
+  RDataReader reader(dataDir + "/s2_data_tbl_" + name + ".rda");
+  std::shared_ptr<RValue> objects = reader.Read();
+  if (objects->items.empty()) {
+    throw std::runtime_error("No objects in s2_data_tbl_" + name + ".rda");
+  }
+
+  std::shared_ptr<RValue> geometry = objects->items[0]->Column("geometry");
+
+  auto dataset = absl::make_unique<Dataset>();
+  dataset->name = name;
+  WKBFeatureReader wkbReader;
+  for (const auto& item: geometry->items) {
+    // missing features are skipped
+    if (item->raw.empty()) {
+      continue;
+    }
+
+    dataset->wkb.push_back(item->raw);
+    dataset->features.push_back(wkbReader.Read(item->raw.data(), item->raw.size()));
+  }
+
+  return dataset;
+}
+
+// Synthetic inputs whose size is controlled by n: uniformly distributed
+// points, and regular polygons with nVertices vertices and a radius of
+// radiusKm centered on uniformly distributed points. Inputs are the same for
+// a given seed.
+inline S2Point randomPoint(std::mt19937& rng) {
+  std::uniform_real_distribution<double> z(-1, 1);
+  std::uniform_real_distribution<double> theta(0, 2 * M_PI);
+  double zValue = z(rng);
+  double r = std::sqrt(1 - zValue * zValue);
+  double thetaValue = theta(rng);
+  return S2Point(r * std::cos(thetaValue), r * std::sin(thetaValue), zValue);
+}
+
+inline void addWKB(Dataset* dataset) {
+  WKBFeatureWriter writer;
+  for (const auto& feature: dataset->features) {
+    dataset->wkb.push_back(writer.Write(*feature));
+  }
+}
+
+inline std::unique_ptr<Dataset> syntheticPoints(int n, uint32_t seed = 1) {
+  std::mt19937 rng(seed);
+  auto dataset = absl::make_unique<Dataset>();
+  dataset->name = "points_" + std::to_string(n);
+  for (int i = 0; i < n; i++) {
+    auto feature = absl::make_unique<Feature>();
+    feature->points.push_back(randomPoint(rng));
+    dataset->features.push_back(std::move(feature));
+  }
+
+  addWKB(dataset.get());
+  return dataset;
+}
+
+inline std::unique_ptr<Dataset> syntheticPolygons(int n, int nVertices, double radiusKm,
+                                                  uint32_t seed = 2) {
+  std::mt19937 rng(seed);
+  auto dataset = absl::make_unique<Dataset>();
+  dataset->name = "polygons_" + std::to_string(n) + "x" + std::to_string(nVertices);
+  S1Angle radius = S1Angle::Radians(radiusKm / 6371.01);
+  for (int i = 0; i < n; i++) {
+    auto feature = absl::make_unique<Feature>();
+    feature->polygon = absl::make_unique<S2Polygon>(
+      S2Loop::MakeRegularLoop(randomPoint(rng), radius, nVertices)
+    );
+    dataset->features.push_back(std::move(feature));
+  }
+
+  addWKB(dataset.get());
+  return dataset;
+}
+
+// Fractal polygons from the generator behind s2_random_polygons(), placed in
+// clusters with the given proportion of overlapping features
+inline std::unique_ptr<Dataset> syntheticFractals(int n, int nVertices, double overlap,
+                                                  int seed = 3) {
+  S2Testing::rnd.Reset(seed);
+  FeatureGenerator::Options options;
+  options.dimension = FeatureGenerator::POLYGON;
+  options.numVertices = nVertices;
+  options.numClusters = 8;
+  options.clusterRadius = S1Angle::Radians(1000 / 6371.01);
+  options.overlap = overlap;
+  FeatureGenerator generator(n, options);
+
+  auto dataset = absl::make_unique<Dataset>();
+  dataset->name = "fractals_" + std::to_string(n) + "x" + std::to_string(nVertices);
+  for (size_t i = 0; i < generator.NumFeatures(); i++) {
+    auto feature = absl::make_unique<Feature>();
+    feature->polygon = absl::make_unique<S2Polygon>(
+      absl::make_unique<S2Loop>(generator.Vertices(i))
+    );
+    dataset->features.push_back(std::move(feature));
+  }
+
+  addWKB(dataset.get());
+  return dataset;
+}
+
+// A coverage (i.e., polygons whose interiors don't overlap) of the cells at
+// level on face 0
+inline std::unique_ptr<Dataset> syntheticCoverage(int level) {
+  auto dataset = absl::make_unique<Dataset>();
+  S2CellId end = S2CellId::FromFace(0).child_end(level);
+  for (S2CellId id = S2CellId::FromFace(0).child_begin(level); id != end; id = id.next()) {
+    auto feature = absl::make_unique<Feature>();
+    feature->polygon = absl::make_unique<S2Polygon>(absl::make_unique<S2Loop>(S2Cell(id)));
+    dataset->features.push_back(std::move(feature));
+  }
+
+  dataset->name = "cells_" + std::to_string(dataset->features.size());
+  addWKB(dataset.get());
+  return dataset;
+}
+
+#endif
@@ -0,0 +1,857 @@
+
+// Benchmarks for the operations that dominate the run time of the package,
+// runnable without R (see README.md). Inner loops that the package keeps in
+// R-free headers (e.g., s2-matrix-kernels.h) are included from ../src and
+// called directly; the rest of each benchmark mirrors the code path of the
+// package function named in its comment using the same S2 calls and
+// options, with the R-specific parts (e.g., external pointers and interrupt
+// checks) removed.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <regex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "s2/s2boolean_operation.h"
+#include "s2/s2builder.h"
+#include "s2/s2builderutil_closed_set_normalizer.h"
+#include "s2/s2builderutil_s2point_vector_layer.h"
+#include "s2/s2builderutil_s2polygon_layer.h"
+#include "s2/s2builderutil_s2polyline_vector_layer.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2furthest_edge_query.h"
+#include "s2/s2region_coverer.h"
+#include "s2/s2shape_index_region.h"
+
+#include "bench-data.h"
+#include "../src/s2-cell-index-join.h"
+#include "../src/s2-cell-kernels.h"
+#include "../src/s2-matrix-kernels.h"
+
+// -------- runner ----------
+
+struct Benchmark {
+  std::string name;
+  // runs once before the benchmark is timed, sets the number of items (e.g.,
+  // features or pairs of features) processed by one iteration, and returns
+  // one iteration
+  std::function<std::function<void()>(size_t* items)> setup;
+};
+
+struct BenchmarkResult {
+  std::string name;
+  size_t items;
+  int iterations;
+  double minSeconds;
+  double medianSeconds;
+  double meanSeconds;
+};
+
+BenchmarkResult runBenchmark(const Benchmark& benchmark, double minTime) {
+  size_t items = 0;
+  std::function<void()> iteration = benchmark.setup(&items);
+  std::vector<double> seconds;
+  double total = 0;
+
+  // run at least 3 iterations (or 1 if an iteration takes longer than minTime)
+  while (seconds.empty() || (total < minTime && (seconds.size() < 1000)) ||
+         (seconds.size() < 3 && seconds[0] < minTime)) {
+    auto start = std::chrono::steady_clock::now();
+    iteration();
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    seconds.push_back(elapsed.count());
+    total += elapsed.count();
+  }
+
+  std::sort(seconds.begin(), seconds.end());
+  BenchmarkResult result;
+  result.name = benchmark.name;
+  result.items = items;
+  result.iterations = seconds.size();
+  result.minSeconds = seconds.front();
+  result.medianSeconds = seconds[seconds.size() / 2];
+  result.meanSeconds = total / seconds.size();
+  return result;
+}
+
+void writeResult(const BenchmarkResult& result, const std::string& format, bool first) {
+  double itemsPerSecond = result.items / result.medianSeconds;
+  if (format == "json") {
+    std::printf(
+      "{\"benchmark\": \"%s\", \"items\": %zu, \"iterations\": %d, \"min_seconds\": %.9g, "
+      "\"median_seconds\": %.9g, \"mean_seconds\": %.9g, \"items_per_second\": %.9g}\n",
+      result.name.c_str(), result.items, result.iterations, result.minSeconds,
+      result.medianSeconds, result.meanSeconds, itemsPerSecond
+    );
+  } else {
+    if (first) {
+      std::printf("benchmark,items,iterations,min_seconds,median_seconds,mean_seconds,items_per_second\n");
+    }
+
+    std::printf(
+      "%s,%zu,%d,%.9g,%.9g,%.9g,%.9g\n",
+      result.name.c_str(), result.items, result.iterations, result.minSeconds,
+      result.medianSeconds, result.meanSeconds, itemsPerSecond
+    );
+  }
+
+  std::fflush(stdout);
+}
+
+// -------- shared code paths ----------
+
+// Per-feature indexes (Geography::ShapeIndex()), which the package builds
+// once and keeps for the lifetime of each feature
+std::vector<std::unique_ptr<MutableS2ShapeIndex>> buildFeatureIndexes(const FeatureVector& features,
+                                                                     int maxEdgesPerCell = 10) {
+  std::vector<std::unique_ptr<MutableS2ShapeIndex>> indexes;
+  MutableS2ShapeIndex::Options options;
+  options.set_max_edges_per_cell(maxEdgesPerCell);
+  for (const auto& feature: features) {
+    auto index = absl::make_unique<MutableS2ShapeIndex>(options);
+    feature->BuildShapeIndex(index.get());
+    index->ForceBuild();
+    indexes.push_back(std::move(index));
+  }
+
+  return indexes;
+}
+
+// buildSourcedIndex() in s2-matrix.cpp
+std::unordered_map<int, int> buildSourcedIndex(const FeatureVector& features, MutableS2ShapeIndex* index) {
+  std::unordered_map<int, int> source;
+  for (size_t j = 0; j < features.size(); j++) {
+    int firstShapeId = index->num_shape_ids();
+    features[j]->BuildShapeIndex(index);
+    for (int shapeId = firstShapeId; shapeId < index->num_shape_ids(); shapeId++) {
+      source[shapeId] = j;
+    }
+  }
+
+  return source;
+}
+
+// findPossibleIntersections() in s2-matrix.cpp
+std::unordered_set<int> findPossibleIntersections(const S2Region& region,
+                                                  const MutableS2ShapeIndex* index,
+                                                  std::unordered_map<int, int>& source,
+                                                  int maxRegionCells) {
+  S2RegionCoverer coverer;
+  coverer.mutable_options()->set_max_cells(maxRegionCells);
+  S2CellUnion covering = coverer.GetCovering(region);
+
+  std::unordered_set<int> mightIntersectIndices;
+  findIndexCandidates(covering, index, source, &mightIntersectIndices, []() {});
+  return mightIntersectIndices;
+}
+
+// doBooleanOperation() in s2-transformers.cpp (the output is discarded)
+void doBooleanOperation(const S2ShapeIndex& index1, const S2ShapeIndex& index2,
+                        S2BooleanOperation::OpType opType) {
+  std::vector<S2Point> points;
+  std::vector<std::unique_ptr<S2Polyline>> polylines;
+  S2Polygon polygon;
+
+  s2builderutil::LayerVector layers(3);
+  layers[0] = absl::make_unique<s2builderutil::S2PointVectorLayer>(&points);
+  layers[1] = absl::make_unique<s2builderutil::S2PolylineVectorLayer>(&polylines);
+  layers[2] = absl::make_unique<s2builderutil::S2PolygonLayer>(&polygon);
+
+  S2BooleanOperation booleanOp(opType, s2builderutil::NormalizeClosedSet(std::move(layers)));
+  S2Error error;
+  if (!booleanOp.Build(index1, index2, &error)) {
+    throw std::runtime_error(error.text());
+  }
+}
+
+// rebuildGeography() in s2-transformers.cpp, for polygons only
+void rebuildPolygon(const S2ShapeIndex& index) {
+  S2Polygon polygon;
+  S2Builder builder{S2Builder::Options()};
+  builder.StartLayer(absl::make_unique<s2builderutil::S2PolygonLayer>(&polygon));
+  for (S2Shape* shape: index) {
+    if (shape->dimension() == 2) {
+      builder.AddShape(*shape);
+    }
+  }
+
+  S2Error error;
+  if (!builder.Build(&error)) {
+    throw std::runtime_error(error.text());
+  }
+}
+
+// -------- benchmarks ----------
+
+typedef std::unordered_map<std::string, std::unique_ptr<Dataset>> Datasets;
+
+void addWKBBenchmarks(std::vector<Benchmark>* benchmarks, const Dataset* data) {
+  // s2_geog_from_wkb()
+  benchmarks->push_back({"wkb_import/" + data->name, [data](size_t* items) {
+    *items = data->wkb.size();
+    return [data]() {
+      WKBFeatureReader reader;
+      for (const auto& wkb: data->wkb) {
+        reader.Read(wkb.data(), wkb.size());
+      }
+    };
+  }});
+
+  // s2_as_binary()
+  benchmarks->push_back({"wkb_export/" + data->name, [data](size_t* items) {
+    *items = data->features.size();
+    return [data]() {
+      WKBFeatureWriter writer;
+      for (const auto& feature: data->features) {
+        writer.Write(*feature);
+      }
+    };
+  }});
+}
+
+void addIndexBenchmarks(std::vector<Benchmark>* benchmarks, const Dataset* data) {
+  // IndexedBinaryGeographyOperator::buildIndex() (e.g., the index of `y`
+  // built by every call to s2_intersects_matrix())
+  for (int maxEdgesPerCell: {10, 50}) {
+    std::string name = "index_build/" + data->name + "/max_edges=" + std::to_string(maxEdgesPerCell);
+    benchmarks->push_back({name, [data, maxEdgesPerCell](size_t* items) {
+      *items = data->features.size();
+      return [data, maxEdgesPerCell]() {
+        MutableS2ShapeIndex::Options options;
+        options.set_max_edges_per_cell(maxEdgesPerCell);
+        MutableS2ShapeIndex index(options);
+        buildSourcedIndex(data->features, &index);
+        index.ForceBuild();
+      };
+    }});
+  }
+
+  // Geography::ShapeIndex() for every feature (e.g., the first time a vector
+  // is used in any predicate)
+  benchmarks->push_back({"feature_index_build/" + data->name, [data](size_t* items) {
+    *items = data->features.size();
+    return [data]() {
+      buildFeatureIndexes(data->features);
+    };
+  }});
+}
+
+// s2_intersects_matrix() (with the per-feature indexes of x and y
+// already built, as they would be after the first call)
+void addPredicateMatrixBenchmarks(std::vector<Benchmark>* benchmarks,
+                                  const Dataset* x, const Dataset* y, bool bruteForce) {
+  std::string pair = x->name + "~" + y->name;
+
+  for (int maxEdgesPerCell: {10, 50}) {
+    for (int maxFeatureCells: {1, 4, 8}) {
+      std::string name = "intersects_matrix/" + pair + "/max_edges=" +
+        std::to_string(maxEdgesPerCell) + "/max_cells=" + std::to_string(maxFeatureCells);
+
+      benchmarks->push_back({name, [x, y, maxEdgesPerCell, maxFeatureCells](size_t* items) {
+        *items = x->features.size();
+        auto xIndexes = std::make_shared<std::vector<std::unique_ptr<MutableS2ShapeIndex>>>(
+          buildFeatureIndexes(x->features)
+        );
+        auto yIndexes = std::make_shared<std::vector<std::unique_ptr<MutableS2ShapeIndex>>>(
+          buildFeatureIndexes(y->features)
+        );
+
+        return [x, y, xIndexes, yIndexes, maxEdgesPerCell, maxFeatureCells]() {
+          MutableS2ShapeIndex::Options options;
+          options.set_max_edges_per_cell(maxEdgesPerCell);
+          MutableS2ShapeIndex yIndex(options);
+          std::unordered_map<int, int> source = buildSourcedIndex(y->features, &yIndex);
+
+          for (size_t i = 0; i < xIndexes->size(); i++) {
+            S2ShapeIndex* index1 = (*xIndexes)[i].get();
+            std::unordered_set<int> candidates = findPossibleIntersections(
+              MakeS2ShapeIndexRegion(index1), &yIndex, source, maxFeatureCells
+            );
+
+            std::vector<int> result;
+            for (int j: candidates) {
+              if (S2BooleanOperation::Intersects(*index1, *(*yIndexes)[j])) {
+                result.push_back(j + 1);
+              }
+            }
+
+            std::sort(result.begin(), result.end());
+          }
+        };
+      }});
+    }
+  }
+
+  // s2_intersects_matrix() after s2_covering(cache = TRUE) for x and y
+  // (IndexedMatrixPredicateOperator::joinCoverings())
+  for (int maxCells: {4, 8, 32}) {
+    std::string name = "intersects_matrix_covering_join/" + pair +
+      "/max_cells=" + std::to_string(maxCells);
+
+    benchmarks->push_back({name, [x, y, maxCells](size_t* items) {
+      *items = x->features.size();
+      auto xIndexes = std::make_shared<std::vector<std::unique_ptr<MutableS2ShapeIndex>>>(
+        buildFeatureIndexes(x->features)
+      );
+      auto yIndexes = std::make_shared<std::vector<std::unique_ptr<MutableS2ShapeIndex>>>(
+        buildFeatureIndexes(y->features)
+      );
+
+      S2RegionCoverer coverer;
+      coverer.mutable_options()->set_max_cells(maxCells);
+      auto xCoverings = std::make_shared<std::vector<S2CellUnion>>();
+      for (const auto& index: *xIndexes) {
+        xCoverings->push_back(coverer.GetCovering(MakeS2ShapeIndexRegion(index.get())));
+      }
+      auto yCoverings = std::make_shared<std::vector<S2CellUnion>>();
+      for (const auto& index: *yIndexes) {
+        yCoverings->push_back(coverer.GetCovering(MakeS2ShapeIndexRegion(index.get())));
+      }
+
+      return [xIndexes, yIndexes, xCoverings, yCoverings]() {
+        S2CellIndex index1;
+        for (size_t i = 0; i < xCoverings->size(); i++) {
+          index1.Add((*xCoverings)[i], i);
+        }
+        S2CellIndex index2;
+        for (size_t j = 0; j < yCoverings->size(); j++) {
+          index2.Add((*yCoverings)[j], j);
+        }
+        index1.Build();
+        index2.Build();
+
+        std::vector<std::vector<S2CellIndex::Label>> candidates(xCoverings->size());
+        joinCellIndexes(index1, index2, &candidates);
+
+        for (size_t i = 0; i < xIndexes->size(); i++) {
+          S2ShapeIndex* index1 = (*xIndexes)[i].get();
+          std::vector<int> result;
+          for (int j: candidates[i]) {
+            if (S2BooleanOperation::Intersects(*index1, *(*yIndexes)[j])) {
+              result.push_back(j + 1);
+            }
+          }
+        }
+      };
+    }});
+  }
+
+  // s2_intersects_matrix_brute_force()
+  if (bruteForce) {
+    std::string name = "intersects_matrix_brute_force/" + pair;
+    benchmarks->push_back({name, [x, y](size_t* items) {
+      *items = x->features.size();
+      auto xIndexes = std::make_shared<std::vector<std::unique_ptr<MutableS2ShapeIndex>>>(
+        buildFeatureIndexes(x->features)
+      );
+      auto yIndexes = std::make_shared<std::vector<std::unique_ptr<MutableS2ShapeIndex>>>(
+        buildFeatureIndexes(y->features)
+      );
+
+      return [xIndexes, yIndexes]() {
+        std::vector<int> result;
+        for (const auto& index1: *xIndexes) {
+          result.clear();
+          for (size_t j = 0; j < yIndexes->size(); j++) {
+            if (S2BooleanOperation::Intersects(*index1, *(*yIndexes)[j])) {
+              result.push_back(j + 1);
+            }
+          }
+        }
+      };
+    }});
+  }
+}
+
+// One row of s2_distance_matrix() or s2_max_distance_matrix(), using a single
+// query for the row as in DistanceMatrixOperator
+template<class Query>
+void distanceMatrixRow(MutableS2ShapeIndex* index1,
+                       const std::vector<std::unique_ptr<MutableS2ShapeIndex>>& indexes2,
+                       S1ChordAngle maxError, size_t i, size_t nrow, bool symmetric,
+                       std::vector<double>* values) {
+  Query query(index1);
+  query.mutable_options()->set_max_error(maxError);
+
+  for (size_t j = symmetric ? i : 0; j < indexes2.size(); j++) {
+    double distance = edgeQueryDistance(query, indexes2[j].get()).radians();
+    (*values)[i + j * nrow] = distance;
+    if (symmetric) {
+      (*values)[j + i * nrow] = distance;
+    }
+  }
+}
+
+// s2_distance_matrix(), s2_max_distance_matrix() and s2_closest_feature() for
+// max_error = 0 and a positive max_error (the feature indexes are built
+// during setup, so only the queries are timed). When x and y are the same,
+// only the upper triangle of the matrix is computed, as in the package.
+void addDistanceBenchmarks(std::vector<Benchmark>* benchmarks, const Dataset* x, const Dataset* y) {
+  std::string pair = x->name + "~" + y->name;
+  bool symmetric = x == y;
+
+  // max_error is in meters on the Earth's surface (radius 6371.01 km)
+  for (double maxErrorMeters: {0.0, 1000.0, 10000.0}) {
+    S1ChordAngle maxError = S1ChordAngle::Radians(maxErrorMeters / 6371010.0);
+    std::string suffix = "/max_error=" + std::to_string(static_cast<int>(maxErrorMeters));
+
+    auto addMatrix = [&](const std::string& function, bool furthest) {
+      benchmarks->push_back({function + "/" + pair + suffix,
+                             [x, y, symmetric, maxError, furthest](size_t* items) {
+        *items = x->features.size();
+        auto xIndexes = std::make_shared<std::vector<std::unique_ptr<MutableS2ShapeIndex>>>(
+          buildFeatureIndexes(x->features)
+        );
+        auto yIndexes = std::make_shared<std::vector<std::unique_ptr<MutableS2ShapeIndex>>>(
+          buildFeatureIndexes(y->features)
+        );
+
+        return [xIndexes, yIndexes, symmetric, maxError, furthest]() {
+          size_t nrow = xIndexes->size();
+          size_t ncol = yIndexes->size();
+          std::vector<double> values(nrow * ncol);
+          for (size_t i = 0; i < nrow; i++) {
+            if (furthest) {
+              distanceMatrixRow<S2FurthestEdgeQuery>(
+                (*xIndexes)[i].get(), *yIndexes, maxError, i, nrow, symmetric, &values
+              );
+            } else {
+              distanceMatrixRow<S2ClosestEdgeQuery>(
+                (*xIndexes)[i].get(), *yIndexes, maxError, i, nrow, symmetric, &values
+              );
+            }
+          }
+        };
+      }});
+    };
+
+    addMatrix("distance_matrix", false);
+    addMatrix("max_distance_matrix", true);
+
+    // s2_closest_feature()
+    benchmarks->push_back({"closest_feature/" + pair + suffix, [x, y, maxError](size_t* items) {
+      *items = x->features.size();
+      auto xIndexes = std::make_shared<std::vector<std::unique_ptr<MutableS2ShapeIndex>>>(
+        buildFeatureIndexes(x->features)
+      );
+      auto yIndex = std::make_shared<MutableS2ShapeIndex>();
+      auto source = std::make_shared<std::unordered_map<int, int>>(
+        buildSourcedIndex(y->features, yIndex.get())
+      );
+      yIndex->ForceBuild();
+
+      return [xIndexes, yIndex, source, maxError]() {
+        std::vector<int> result(xIndexes->size());
+        for (size_t i = 0; i < xIndexes->size(); i++) {
+          S2ClosestEdgeQuery query(yIndex.get());
+          query.mutable_options()->set_max_error(maxError);
+          S2ClosestEdgeQuery::ShapeIndexTarget target((*xIndexes)[i].get());
+          const auto& edge = query.FindClosestEdge(&target);
+          result[i] = edge.is_empty() ? -1 : (*source)[edge.shape_id()] + 1;
+        }
+      };
+    }});
+  }
+}
+
+// s2_intersection() and s2_union() for pairs of features whose interiors
+// intersect (i.e., pairs that exercise the whole operation)
+void addBooleanBenchmarks(std::vector<Benchmark>* benchmarks, const Dataset* x, const Dataset* y,
+                          size_t maxPairs) {
+  struct Pairs {
+    std::vector<std::unique_ptr<MutableS2ShapeIndex>> xIndexes;
+    std::vector<std::unique_ptr<MutableS2ShapeIndex>> yIndexes;
+    std::vector<std::pair<int, int>> pairs;
+  };
+
+  auto setupPairs = [x, y, maxPairs]() {
+    auto pairs = std::make_shared<Pairs>();
+    pairs->xIndexes = buildFeatureIndexes(x->features);
+    pairs->yIndexes = buildFeatureIndexes(y->features);
+    for (size_t i = 0; i < x->features.size() && pairs->pairs.size() < maxPairs; i++) {
+      for (size_t j = 0; j < y->features.size() && pairs->pairs.size() < maxPairs; j++) {
+        if (S2BooleanOperation::Intersects(*pairs->xIndexes[i], *pairs->yIndexes[j])) {
+          pairs->pairs.push_back(std::make_pair(i, j));
+        }
+      }
+    }
+
+    return pairs;
+  };
+
+  std::string pair = x->name + "~" + y->name;
+  std::vector<std::pair<std::string, S2BooleanOperation::OpType>> ops = {
+    {"intersection", S2BooleanOperation::OpType::INTERSECTION},
+    {"union", S2BooleanOperation::OpType::UNION}
+  };
+
+  for (const auto& op: ops) {
+    S2BooleanOperation::OpType opType = op.second;
+    benchmarks->push_back({op.first + "/" + pair, [setupPairs, opType](size_t* items) {
+      std::shared_ptr<Pairs> pairs = setupPairs();
+      *items = pairs->pairs.size();
+      return [pairs, opType]() {
+        for (const auto& pair: pairs->pairs) {
+          doBooleanOperation(*pairs->xIndexes[pair.first], *pairs->yIndexes[pair.second], opType);
+        }
+      };
+    }});
+  }
+}
+
+void addAggregateBenchmarks(std::vector<Benchmark>* benchmarks, const Dataset* data,
+                            bool isCoverage) {
+  // s2_coverage_union_agg() (only valid for polygons whose interiors don't overlap)
+  if (isCoverage) {
+    benchmarks->push_back({"coverage_union_agg/" + data->name, [data](size_t* items) {
+      *items = data->features.size();
+      return [data]() {
+        MutableS2ShapeIndex index;
+        for (const auto& feature: data->features) {
+          feature->BuildShapeIndex(&index);
+        }
+
+        MutableS2ShapeIndex emptyIndex;
+        doBooleanOperation(index, emptyIndex, S2BooleanOperation::OpType::UNION);
+      };
+    }});
+  }
+
+  // s2_union_agg()
+  benchmarks->push_back({"union_agg/" + data->name, [data](size_t* items) {
+    *items = data->features.size();
+    auto indexes = std::make_shared<std::vector<std::unique_ptr<MutableS2ShapeIndex>>>(
+      buildFeatureIndexes(data->features)
+    );
+
+    return [indexes]() {
+      auto index = absl::make_unique<MutableS2ShapeIndex>();
+      auto accumulatedIndex = absl::make_unique<MutableS2ShapeIndex>();
+
+      for (const auto& featureIndex: *indexes) {
+        index->Clear();
+        s2builderutil::LayerVector layers(3);
+        layers[0] = absl::make_unique<s2builderutil::IndexedS2PointVectorLayer>(index.get());
+        layers[1] = absl::make_unique<s2builderutil::IndexedS2PolylineVectorLayer>(index.get());
+        layers[2] = absl::make_unique<s2builderutil::IndexedS2PolygonLayer>(index.get());
+
+        S2BooleanOperation booleanOp(
+          S2BooleanOperation::OpType::UNION,
+          s2builderutil::NormalizeClosedSet(std::move(layers))
+        );
+
+        S2Error error;
+        if (!booleanOp.Build(*accumulatedIndex, *featureIndex, &error)) {
+          throw std::runtime_error(error.text());
+        }
+
+        accumulatedIndex.swap(index);
+      }
+
+      rebuildPolygon(*accumulatedIndex);
+    };
+  }});
+}
+
+// s2_cell vector functions
+void addCellBenchmarks(std::vector<Benchmark>* benchmarks, const Dataset* data) {
+  auto points = std::make_shared<std::vector<S2Point>>();
+  for (const auto& feature: data->features) {
+    points->insert(points->end(), feature->points.begin(), feature->points.end());
+  }
+
+  auto ids = std::make_shared<std::vector<S2CellId>>();
+  for (const S2Point& point: *points) {
+    ids->push_back(S2CellId(point));
+  }
+
+  // as_s2_cell.s2_geography()
+  benchmarks->push_back({"cell_from_point/" + data->name, [points](size_t* items) {
+    *items = points->size();
+    return [points]() {
+      std::vector<uint64_t> result(points->size());
+      for (size_t i = 0; i < points->size(); i++) {
+        result[i] = S2CellId((*points)[i]).id();
+      }
+    };
+  }});
+
+  // as_s2_cell.s2_lnglat(level = 13) before it used cellFromLngLatBatch(),
+  // and with the kernel
+  auto lngs = std::make_shared<std::vector<double>>();
+  auto lats = std::make_shared<std::vector<double>>();
+  for (const S2Point& point: *points) {
+    S2LatLng ll(point);
+    lngs->push_back(ll.lng().degrees());
+    lats->push_back(ll.lat().degrees());
+  }
+
+  benchmarks->push_back({"cell_from_lnglat/" + data->name, [lngs, lats](size_t* items) {
+    *items = lngs->size();
+    return [lngs, lats]() {
+      std::vector<uint64_t> result(lngs->size());
+      for (size_t i = 0; i < lngs->size(); i++) {
+        S2LatLng ll = S2LatLng::FromDegrees((*lats)[i], (*lngs)[i]).Normalized();
+        result[i] = S2CellId(ll).parent(13).id();
+      }
+    };
+  }});
+
+  benchmarks->push_back({"cell_from_lnglat_kernel/" + data->name, [lngs, lats](size_t* items) {
+    *items = lngs->size();
+    return [lngs, lats]() {
+      std::vector<uint64_t> result(lngs->size());
+      cellFromLngLatBatch(lngs->data(), lats->data(), lngs->size(), 13, result.data(), 0);
+    };
+  }});
+
+  // s2_cell_parent()
+  benchmarks->push_back({"cell_parent/" + data->name, [ids](size_t* items) {
+    *items = ids->size();
+    return [ids]() {
+      std::vector<uint64_t> result(ids->size());
+      for (size_t i = 0; i < ids->size(); i++) {
+        result[i] = (*ids)[i].parent(10).id();
+      }
+    };
+  }});
+
+  // s2_cell_contains(), one cell against many, as it was before
+  // CellContainsKernel and with the kernel
+  benchmarks->push_back({"cell_contains/" + data->name, [ids](size_t* items) {
+    *items = ids->size();
+    return [ids]() {
+      S2CellId face = (*ids)[0].parent(0);
+      std::vector<int> result(ids->size());
+      for (size_t i = 0; i < ids->size(); i++) {
+        S2CellId cellId = (*ids)[i];
+        result[i] = face.is_valid() && cellId.is_valid() ? face.contains(cellId) : -1;
+      }
+    };
+  }});
+
+  benchmarks->push_back({"cell_contains_kernel/" + data->name, [ids](size_t* items) {
+    *items = ids->size();
+    auto rawIds = std::make_shared<std::vector<uint64_t>>();
+    for (const S2CellId& id: *ids) {
+      rawIds->push_back(id.id());
+    }
+
+    return [rawIds]() {
+      uint64_t face = S2CellId((*rawIds)[0]).parent(0).id();
+      std::vector<int> result(rawIds->size());
+      cellBinaryBatch(
+        &face, true, rawIds->data(), false,
+        rawIds->size(), result.data(), CellContainsKernel{-1}
+      );
+    };
+  }});
+
+  // s2_cell_to_lnglat()
+  benchmarks->push_back({"cell_to_lnglat/" + data->name, [ids](size_t* items) {
+    *items = ids->size();
+    return [ids]() {
+      std::vector<double> lng(ids->size());
+      std::vector<double> lat(ids->size());
+      for (size_t i = 0; i < ids->size(); i++) {
+        S2LatLng ll = (*ids)[i].ToLatLng();
+        lng[i] = ll.lng().degrees();
+        lat[i] = ll.lat().degrees();
+      }
+    };
+  }});
+
+  // as.character.s2_cell()
+  benchmarks->push_back({"cell_to_token/" + data->name, [ids](size_t* items) {
+    *items = ids->size();
+    return [ids]() {
+      std::vector<std::string> result(ids->size());
+      for (size_t i = 0; i < ids->size(); i++) {
+        result[i] = (*ids)[i].ToToken();
+      }
+    };
+  }});
+
+  // as_s2_cell.character()
+  benchmarks->push_back({"cell_from_token/" + data->name, [ids](size_t* items) {
+    *items = ids->size();
+    auto tokens = std::make_shared<std::vector<std::string>>();
+    for (const S2CellId& id: *ids) {
+      tokens->push_back(id.ToToken());
+    }
+
+    return [tokens]() {
+      std::vector<uint64_t> result(tokens->size());
+      for (size_t i = 0; i < tokens->size(); i++) {
+        result[i] = S2CellId::FromToken((*tokens)[i]).id();
+      }
+    };
+  }});
+
+  // as.character.s2_cell() and as_s2_cell.character() with cellToToken() and
+  // cellFromToken() (without creating or reading CHARSXPs)
+  benchmarks->push_back({"cell_to_token_kernel/" + data->name, [ids](size_t* items) {
+    *items = ids->size();
+    return [ids]() {
+      std::vector<char> result(ids->size() * 16);
+      for (size_t i = 0; i < ids->size(); i++) {
+        cellToToken((*ids)[i].id(), result.data() + i * 16);
+      }
+    };
+  }});
+
+  benchmarks->push_back({"cell_from_token_kernel/" + data->name, [ids](size_t* items) {
+    *items = ids->size();
+    auto tokens = std::make_shared<std::vector<std::string>>();
+    for (const S2CellId& id: *ids) {
+      tokens->push_back(id.ToToken());
+    }
+
+    return [tokens]() {
+      std::vector<uint64_t> result(tokens->size());
+      for (size_t i = 0; i < tokens->size(); i++) {
+        result[i] = cellFromToken((*tokens)[i].data(), (*tokens)[i].size());
+      }
+    };
+  }});
+
+  // sort.s2_cell() before it used radixSortCellIds() (s2-cell-sort.h uses
+  // parallelFor(), which depends on Rcpp), as a baseline
+  benchmarks->push_back({"cell_sort/" + data->name, [ids](size_t* items) {
+    *items = ids->size();
+    return [ids]() {
+      std::vector<uint64_t> result(ids->size());
+      for (size_t i = 0; i < ids->size(); i++) {
+        result[i] = (*ids)[i].id();
+      }
+
+      std::sort(result.begin(), result.end());
+    };
+  }});
+}
+
+std::vector<Benchmark> allBenchmarks(const Datasets& datasets) {
+  const Dataset* countries = datasets.at("countries").get();
+  const Dataset* cities = datasets.at("cities").get();
+  const Dataset* timezones = datasets.at("timezones").get();
+  const Dataset* points = datasets.at("points").get();
+  const Dataset* polygons = datasets.at("polygons").get();
+  const Dataset* fractals = datasets.at("fractals").get();
+  const Dataset* coverage = datasets.at("coverage").get();
+
+  std::vector<Benchmark> benchmarks;
+  for (const Dataset* data: {countries, cities, timezones, points, polygons, fractals, coverage}) {
+    addWKBBenchmarks(&benchmarks, data);
+  }
+
+  for (const Dataset* data: {countries, timezones, polygons, fractals}) {
+    addIndexBenchmarks(&benchmarks, data);
+  }
+
+  addPredicateMatrixBenchmarks(&benchmarks, cities, countries, true);
+  addPredicateMatrixBenchmarks(&benchmarks, countries, countries, true);
+  addPredicateMatrixBenchmarks(&benchmarks, countries, timezones, false);
+  addPredicateMatrixBenchmarks(&benchmarks, points, polygons, false);
+  addPredicateMatrixBenchmarks(&benchmarks, polygons, polygons, false);
+  addPredicateMatrixBenchmarks(&benchmarks, fractals, fractals, false);
+
+  addDistanceBenchmarks(&benchmarks, countries, countries);
+  addDistanceBenchmarks(&benchmarks, cities, countries);
+
+  addBooleanBenchmarks(&benchmarks, countries, timezones, 200);
+  addBooleanBenchmarks(&benchmarks, polygons, polygons, 200);
+  addBooleanBenchmarks(&benchmarks, fractals, fractals, 200);
+
+  addAggregateBenchmarks(&benchmarks, countries, false);
+  addAggregateBenchmarks(&benchmarks, coverage, true);
+
+  addCellBenchmarks(&benchmarks, points);
+
+  return benchmarks;
+}
+
+// -------- main ----------
+
+void usage() {
+  std::cerr <<
+    "Usage: s2bench [options]\n"
+    "  --data=DIR       directory containing the package's .rda files (default: ../data)\n"
+    "  --filter=REGEX   run benchmarks whose name matches REGEX\n"
+    "  --format=FORMAT  csv (default) or json (one object per line)\n"
+    "  --min-time=SEC   minimum time to run each benchmark (default: 0.5)\n"
+    "  --scale=X        multiply the size of synthetic inputs by X (default: 1)\n"
+    "  --list           list benchmarks without running them\n";
+}
+
+int main(int argc, char* argv[]) {
+  std::string dataDir = "../data";
+  std::string filter = ".*";
+  std::string format = "csv";
+  double minTime = 0.5;
+  double scale = 1;
+  bool list = false;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    size_t eq = arg.find('=');
+    std::string key = arg.substr(0, eq);
+    std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+    if (key == "--data") {
+      dataDir = value;
+    } else if (key == "--filter") {
+      filter = value;
+    } else if (key == "--format" && (value == "csv" || value == "json")) {
+      format = value;
+    } else if (key == "--min-time") {
+      minTime = std::atof(value.c_str());
+    } else if (key == "--scale") {
+      scale = std::atof(value.c_str());
+    } else if (key == "--list") {
+      list = true;
+    } else {
+      usage();
+      return 1;
+    }
+  }
+
+  try {
+    Datasets datasets;
+    for (const std::string& name: {"countries", "cities", "timezones"}) {
+      datasets[name] = readPackageData(dataDir, name);
+    }
+
+    datasets["points"] = syntheticPoints(std::max(1, static_cast<int>(10000 * scale)));
+    datasets["polygons"] = syntheticPolygons(std::max(1, static_cast<int>(1000 * scale)), 64, 200);
+    datasets["fractals"] = syntheticFractals(std::max(1, static_cast<int>(1000 * scale)), 192, 0.2);
+    datasets["coverage"] = syntheticCoverage(5);
+
+    std::regex pattern(filter);
+    bool first = true;
+    for (const Benchmark& benchmark: allBenchmarks(datasets)) {
+      if (!std::regex_search(benchmark.name, pattern)) {
+        continue;
+      }
+
+      if (list) {
+        std::printf("%s\n", benchmark.name.c_str());
+      } else {
+        writeResult(runBenchmark(benchmark, minTime), format, first);
+        first = false;
+      }
+    }
+  } catch (std::exception& e) {
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+
+  return 0;
+}
@@ -144,8 +144,18 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
     int max_edges_per_cell() const { return max_edges_per_cell_; }
     void set_max_edges_per_cell(int max_edges_per_cell);
 
+    // The number of threads used to apply pending updates.  When this is
+    // greater than one, the six cube faces (and the largest cells within each
+    // face) are updated concurrently.  The resulting index is identical to
+    // the one built using a single thread.
+    //
+    // DEFAULT: 1
+    int num_threads() const { return num_threads_; }
+    void set_num_threads(int num_threads);
+
    private:
     int max_edges_per_cell_;
+    int num_threads_;
   };
 
   // Creates a MutableS2ShapeIndex that uses the default option settings.
@@ -319,6 +329,8 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
   struct BatchDescriptor;
   struct ClippedEdge;
   class EdgeAllocator;
+  struct CellUpdates;
+  struct UpdateTask;
   struct FaceEdge;
   class InteriorTracker;
   struct RemovedShape;
@@ -351,24 +363,38 @@ class MutableS2ShapeIndex final : public S2ShapeIndex {
   void AddFaceEdge(FaceEdge* edge, std::vector<FaceEdge> all_edges[6]) const;
   void UpdateFaceEdges(int face, const std::vector<FaceEdge>& face_edges,
                        InteriorTracker* tracker);
+  void UpdateFaceEdgesParallel(std::vector<FaceEdge> all_edges[6],
+                               InteriorTracker* tracker);
+  void AddSkippedCellTasks(
+      S2CellId begin, S2CellId end, bool disjoint_from_index,
+      std::vector<std::unique_ptr<UpdateTask>>* tasks) const;
+  void AddUpdateTasks(
+      const S2PaddedCell& pcell, const std::vector<const ClippedEdge*>& edges,
+      size_t max_task_edges, EdgeAllocator* alloc, bool disjoint_from_index,
+      std::vector<std::unique_ptr<UpdateTask>>* tasks) const;
   S2CellId ShrinkToFit(const S2PaddedCell& pcell, const R2Rect& bound) const;
   void SkipCellRange(S2CellId begin, S2CellId end, InteriorTracker* tracker,
                      EdgeAllocator* alloc, bool disjoint_from_index);
   void UpdateEdges(const S2PaddedCell& pcell,
                    std::vector<const ClippedEdge*>* edges,
                    InteriorTracker* tracker, EdgeAllocator* alloc,
-                   bool disjoint_from_index);
+                   bool disjoint_from_index, CellUpdates* updates = nullptr);
+  static void ClipChildEdges(
+      const S2PaddedCell& pcell, const std::vector<const ClippedEdge*>& edges,
+      std::vector<const ClippedEdge*> child_edges[2][2], EdgeAllocator* alloc);
   void AbsorbIndexCell(const S2PaddedCell& pcell,
                        const Iterator& iter,
                        std::vector<const ClippedEdge*>* edges,
                        InteriorTracker* tracker,
-                       EdgeAllocator* alloc);
+                       EdgeAllocator* alloc, CellUpdates* updates);
   int GetEdgeMaxLevel(const S2Shape::Edge& edge) const;
   static int CountShapes(const std::vector<const ClippedEdge*>& edges,
                          const ShapeIdSet& cshape_ids);
+  bool FitsInIndexCell(const S2PaddedCell& pcell,
+                       const std::vector<const ClippedEdge*>& edges) const;
   bool MakeIndexCell(const S2PaddedCell& pcell,
                      const std::vector<const ClippedEdge*>& edges,
-                     InteriorTracker* tracker);
+                     InteriorTracker* tracker, CellUpdates* updates);
   static void TestAllEdges(const std::vector<const ClippedEdge*>& edges,
                            InteriorTracker* tracker);
   inline static const ClippedEdge* UpdateBound(const ClippedEdge* edge,
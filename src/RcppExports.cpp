@@ -148,26 +148,28 @@ BEGIN_RCPP
 END_RCPP
 }
 // cpp_s2_distance
-NumericVector cpp_s2_distance(List geog1, List geog2);
-RcppExport SEXP _s2_cpp_s2_distance(SEXP geog1SEXP, SEXP geog2SEXP) {
+NumericVector cpp_s2_distance(List geog1, List geog2, double maxError);
+RcppExport SEXP _s2_cpp_s2_distance(SEXP geog1SEXP, SEXP geog2SEXP, SEXP maxErrorSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< List >::type geog1(geog1SEXP);
     Rcpp::traits::input_parameter< List >::type geog2(geog2SEXP);
-    rcpp_result_gen = Rcpp::wrap(cpp_s2_distance(geog1, geog2));
+    Rcpp::traits::input_parameter< double >::type maxError(maxErrorSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_distance(geog1, geog2, maxError));
     return rcpp_result_gen;
 END_RCPP
 }
 // cpp_s2_max_distance
-NumericVector cpp_s2_max_distance(List geog1, List geog2);
-RcppExport SEXP _s2_cpp_s2_max_distance(SEXP geog1SEXP, SEXP geog2SEXP) {
+NumericVector cpp_s2_max_distance(List geog1, List geog2, double maxError);
+RcppExport SEXP _s2_cpp_s2_max_distance(SEXP geog1SEXP, SEXP geog2SEXP, SEXP maxErrorSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< List >::type geog1(geog1SEXP);
     Rcpp::traits::input_parameter< List >::type geog2(geog2SEXP);
-    rcpp_result_gen = Rcpp::wrap(cpp_s2_max_distance(geog1, geog2));
+    Rcpp::traits::input_parameter< double >::type maxError(maxErrorSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_max_distance(geog1, geog2, maxError));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -193,6 +195,151 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// cpp_s2_covering
+List cpp_s2_covering(List geog, int minLevel, int maxLevel, int maxCells, bool interior, bool cache, int numThreads);
+RcppExport SEXP _s2_cpp_s2_covering(SEXP geogSEXP, SEXP minLevelSEXP, SEXP maxLevelSEXP, SEXP maxCellsSEXP, SEXP interiorSEXP, SEXP cacheSEXP, SEXP numThreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type geog(geogSEXP);
+    Rcpp::traits::input_parameter< int >::type minLevel(minLevelSEXP);
+    Rcpp::traits::input_parameter< int >::type maxLevel(maxLevelSEXP);
+    Rcpp::traits::input_parameter< int >::type maxCells(maxCellsSEXP);
+    Rcpp::traits::input_parameter< bool >::type interior(interiorSEXP);
+    Rcpp::traits::input_parameter< bool >::type cache(cacheSEXP);
+    Rcpp::traits::input_parameter< int >::type numThreads(numThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_covering(geog, minLevel, maxLevel, maxCells, interior, cache, numThreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_cell_union_normalize
+List cpp_s2_cell_union_normalize(List cellIdsList);
+RcppExport SEXP _s2_cpp_s2_cell_union_normalize(SEXP cellIdsListSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type cellIdsList(cellIdsListSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_union_normalize(cellIdsList));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_cell_union_from_cell
+List cpp_s2_cell_union_from_cell(NumericVector cellIdVector);
+RcppExport SEXP _s2_cpp_s2_cell_union_from_cell(SEXP cellIdVectorSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type cellIdVector(cellIdVectorSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_union_from_cell(cellIdVector));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_cell_union_union
+List cpp_s2_cell_union_union(List cellUnionVector1, List cellUnionVector2);
+RcppExport SEXP _s2_cpp_s2_cell_union_union(SEXP cellUnionVector1SEXP, SEXP cellUnionVector2SEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type cellUnionVector1(cellUnionVector1SEXP);
+    Rcpp::traits::input_parameter< List >::type cellUnionVector2(cellUnionVector2SEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_union_union(cellUnionVector1, cellUnionVector2));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_cell_union_intersection
+List cpp_s2_cell_union_intersection(List cellUnionVector1, List cellUnionVector2);
+RcppExport SEXP _s2_cpp_s2_cell_union_intersection(SEXP cellUnionVector1SEXP, SEXP cellUnionVector2SEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type cellUnionVector1(cellUnionVector1SEXP);
+    Rcpp::traits::input_parameter< List >::type cellUnionVector2(cellUnionVector2SEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_union_intersection(cellUnionVector1, cellUnionVector2));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_cell_union_difference
+List cpp_s2_cell_union_difference(List cellUnionVector1, List cellUnionVector2);
+RcppExport SEXP _s2_cpp_s2_cell_union_difference(SEXP cellUnionVector1SEXP, SEXP cellUnionVector2SEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type cellUnionVector1(cellUnionVector1SEXP);
+    Rcpp::traits::input_parameter< List >::type cellUnionVector2(cellUnionVector2SEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_union_difference(cellUnionVector1, cellUnionVector2));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_cell_union_contains
+LogicalVector cpp_s2_cell_union_contains(List cellUnionVector1, List cellUnionVector2);
+RcppExport SEXP _s2_cpp_s2_cell_union_contains(SEXP cellUnionVector1SEXP, SEXP cellUnionVector2SEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type cellUnionVector1(cellUnionVector1SEXP);
+    Rcpp::traits::input_parameter< List >::type cellUnionVector2(cellUnionVector2SEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_union_contains(cellUnionVector1, cellUnionVector2));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_cell_union_intersects
+LogicalVector cpp_s2_cell_union_intersects(List cellUnionVector1, List cellUnionVector2);
+RcppExport SEXP _s2_cpp_s2_cell_union_intersects(SEXP cellUnionVector1SEXP, SEXP cellUnionVector2SEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type cellUnionVector1(cellUnionVector1SEXP);
+    Rcpp::traits::input_parameter< List >::type cellUnionVector2(cellUnionVector2SEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_union_intersects(cellUnionVector1, cellUnionVector2));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_cell_union_contains_cell
+LogicalVector cpp_s2_cell_union_contains_cell(List cellUnionVector, NumericVector cellIdVector);
+RcppExport SEXP _s2_cpp_s2_cell_union_contains_cell(SEXP cellUnionVectorSEXP, SEXP cellIdVectorSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type cellUnionVector(cellUnionVectorSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type cellIdVector(cellIdVectorSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_union_contains_cell(cellUnionVector, cellIdVector));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_cell_union_intersects_cell
+LogicalVector cpp_s2_cell_union_intersects_cell(List cellUnionVector, NumericVector cellIdVector);
+RcppExport SEXP _s2_cpp_s2_cell_union_intersects_cell(SEXP cellUnionVectorSEXP, SEXP cellIdVectorSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type cellUnionVector(cellUnionVectorSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type cellIdVector(cellIdVectorSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_union_intersects_cell(cellUnionVector, cellIdVector));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_cell_union_area
+NumericVector cpp_s2_cell_union_area(List cellUnionVector);
+RcppExport SEXP _s2_cpp_s2_cell_union_area(SEXP cellUnionVectorSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type cellUnionVector(cellUnionVectorSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_union_area(cellUnionVector));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_geography_from_cell_union
+List cpp_s2_geography_from_cell_union(List cellUnionVector);
+RcppExport SEXP _s2_cpp_s2_geography_from_cell_union(SEXP cellUnionVectorSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type cellUnionVector(cellUnionVectorSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_geography_from_cell_union(cellUnionVector));
+    return rcpp_result_gen;
+END_RCPP
+}
 // cpp_s2_cell_sentinel
 NumericVector cpp_s2_cell_sentinel();
 RcppExport SEXP _s2_cpp_s2_cell_sentinel() {
@@ -215,13 +362,15 @@ BEGIN_RCPP
 END_RCPP
 }
 // cpp_s2_cell_from_lnglat
-NumericVector cpp_s2_cell_from_lnglat(List lnglat);
-RcppExport SEXP _s2_cpp_s2_cell_from_lnglat(SEXP lnglatSEXP) {
+NumericVector cpp_s2_cell_from_lnglat(List lnglat, int level, int numThreads);
+RcppExport SEXP _s2_cpp_s2_cell_from_lnglat(SEXP lnglatSEXP, SEXP levelSEXP, SEXP numThreadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< List >::type lnglat(lnglatSEXP);
-    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_from_lnglat(lnglat));
+    Rcpp::traits::input_parameter< int >::type level(levelSEXP);
+    Rcpp::traits::input_parameter< int >::type numThreads(numThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_from_lnglat(lnglat, level, numThreads));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -248,14 +397,15 @@ BEGIN_RCPP
 END_RCPP
 }
 // cpp_s2_cell_sort
-NumericVector cpp_s2_cell_sort(NumericVector cellIdVector, bool decreasing);
-RcppExport SEXP _s2_cpp_s2_cell_sort(SEXP cellIdVectorSEXP, SEXP decreasingSEXP) {
+NumericVector cpp_s2_cell_sort(NumericVector cellIdVector, bool decreasing, int numThreads);
+RcppExport SEXP _s2_cpp_s2_cell_sort(SEXP cellIdVectorSEXP, SEXP decreasingSEXP, SEXP numThreadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< NumericVector >::type cellIdVector(cellIdVectorSEXP);
     Rcpp::traits::input_parameter< bool >::type decreasing(decreasingSEXP);
-    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_sort(cellIdVector, decreasing));
+    Rcpp::traits::input_parameter< int >::type numThreads(numThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_sort(cellIdVector, decreasing, numThreads));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -272,13 +422,41 @@ BEGIN_RCPP
 END_RCPP
 }
 // cpp_s2_cell_unique
-NumericVector cpp_s2_cell_unique(NumericVector cellIdVector);
-RcppExport SEXP _s2_cpp_s2_cell_unique(SEXP cellIdVectorSEXP) {
+NumericVector cpp_s2_cell_unique(NumericVector cellIdVector, int numThreads);
+RcppExport SEXP _s2_cpp_s2_cell_unique(SEXP cellIdVectorSEXP, SEXP numThreadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< NumericVector >::type cellIdVector(cellIdVectorSEXP);
-    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_unique(cellIdVector));
+    Rcpp::traits::input_parameter< int >::type numThreads(numThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_unique(cellIdVector, numThreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_cell_count
+List cpp_s2_cell_count(NumericVector cellIdVector, int numThreads);
+RcppExport SEXP _s2_cpp_s2_cell_count(SEXP cellIdVectorSEXP, SEXP numThreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type cellIdVector(cellIdVectorSEXP);
+    Rcpp::traits::input_parameter< int >::type numThreads(numThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_count(cellIdVector, numThreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_cell_bin
+List cpp_s2_cell_bin(List lnglat, int level, NumericVector weights, bool weighted, int numThreads);
+RcppExport SEXP _s2_cpp_s2_cell_bin(SEXP lnglatSEXP, SEXP levelSEXP, SEXP weightsSEXP, SEXP weightedSEXP, SEXP numThreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type lnglat(lnglatSEXP);
+    Rcpp::traits::input_parameter< int >::type level(levelSEXP);
+    Rcpp::traits::input_parameter< NumericVector >::type weights(weightsSEXP);
+    Rcpp::traits::input_parameter< bool >::type weighted(weightedSEXP);
+    Rcpp::traits::input_parameter< int >::type numThreads(numThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_bin(lnglat, level, weights, weighted, numThreads));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -394,6 +572,28 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// cpp_s2_cell_range_min
+NumericVector cpp_s2_cell_range_min(NumericVector cellIdVector);
+RcppExport SEXP _s2_cpp_s2_cell_range_min(SEXP cellIdVectorSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type cellIdVector(cellIdVectorSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_range_min(cellIdVector));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_cell_range_max
+NumericVector cpp_s2_cell_range_max(NumericVector cellIdVector);
+RcppExport SEXP _s2_cpp_s2_cell_range_max(SEXP cellIdVectorSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type cellIdVector(cellIdVectorSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_range_max(cellIdVector));
+    return rcpp_result_gen;
+END_RCPP
+}
 // cpp_s2_cell_child
 NumericVector cpp_s2_cell_child(NumericVector cellIdVector, IntegerVector k);
 RcppExport SEXP _s2_cpp_s2_cell_child(SEXP cellIdVectorSEXP, SEXP kSEXP) {
@@ -418,6 +618,32 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// cpp_s2_cell_k_ring
+List cpp_s2_cell_k_ring(NumericVector cellIdVector, int k, int numThreads);
+RcppExport SEXP _s2_cpp_s2_cell_k_ring(SEXP cellIdVectorSEXP, SEXP kSEXP, SEXP numThreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type cellIdVector(cellIdVectorSEXP);
+    Rcpp::traits::input_parameter< int >::type k(kSEXP);
+    Rcpp::traits::input_parameter< int >::type numThreads(numThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_k_ring(cellIdVector, k, numThreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_cell_disk
+List cpp_s2_cell_disk(NumericVector cellIdVector, double distance, int numThreads);
+RcppExport SEXP _s2_cpp_s2_cell_disk(SEXP cellIdVectorSEXP, SEXP distanceSEXP, SEXP numThreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< NumericVector >::type cellIdVector(cellIdVectorSEXP);
+    Rcpp::traits::input_parameter< double >::type distance(distanceSEXP);
+    Rcpp::traits::input_parameter< int >::type numThreads(numThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_cell_disk(cellIdVector, distance, numThreads));
+    return rcpp_result_gen;
+END_RCPP
+}
 // cpp_s2_cell_cummax
 NumericVector cpp_s2_cell_cummax(NumericVector cellIdVector);
 RcppExport SEXP _s2_cpp_s2_cell_cummax(SEXP cellIdVectorSEXP) {
@@ -601,6 +827,62 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// cpp_s2_feature_index
+SEXP cpp_s2_feature_index(int maxEdgesPerCell);
+RcppExport SEXP _s2_cpp_s2_feature_index(SEXP maxEdgesPerCellSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type maxEdgesPerCell(maxEdgesPerCellSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_feature_index(maxEdgesPerCell));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_feature_index_append
+IntegerVector cpp_s2_feature_index_append(SEXP index, List geog);
+RcppExport SEXP _s2_cpp_s2_feature_index_append(SEXP indexSEXP, SEXP geogSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type index(indexSEXP);
+    Rcpp::traits::input_parameter< List >::type geog(geogSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_feature_index_append(index, geog));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_feature_index_remove
+void cpp_s2_feature_index_remove(SEXP index, IntegerVector ids);
+RcppExport SEXP _s2_cpp_s2_feature_index_remove(SEXP indexSEXP, SEXP idsSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type index(indexSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type ids(idsSEXP);
+    cpp_s2_feature_index_remove(index, ids);
+    return R_NilValue;
+END_RCPP
+}
+// cpp_s2_feature_index_ids
+IntegerVector cpp_s2_feature_index_ids(SEXP index);
+RcppExport SEXP _s2_cpp_s2_feature_index_ids(SEXP indexSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type index(indexSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_feature_index_ids(index));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_feature_index_info
+List cpp_s2_feature_index_info(SEXP index);
+RcppExport SEXP _s2_cpp_s2_feature_index_info(SEXP indexSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type index(indexSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_feature_index_info(index));
+    return rcpp_result_gen;
+END_RCPP
+}
 // s2_geography_from_wkb
 List s2_geography_from_wkb(List wkb, bool oriented, bool check);
 RcppExport SEXP _s2_s2_geography_from_wkb(SEXP wkbSEXP, SEXP orientedSEXP, SEXP checkSEXP) {
@@ -663,6 +945,74 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// s2_geography_serialize
+List s2_geography_serialize(List s2_geography, bool index);
+RcppExport SEXP _s2_s2_geography_serialize(SEXP s2_geographySEXP, SEXP indexSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type s2_geography(s2_geographySEXP);
+    Rcpp::traits::input_parameter< bool >::type index(indexSEXP);
+    rcpp_result_gen = Rcpp::wrap(s2_geography_serialize(s2_geography, index));
+    return rcpp_result_gen;
+END_RCPP
+}
+// s2_geography_unserialize
+List s2_geography_unserialize(List serialized, bool decode);
+RcppExport SEXP _s2_s2_geography_unserialize(SEXP serializedSEXP, SEXP decodeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type serialized(serializedSEXP);
+    Rcpp::traits::input_parameter< bool >::type decode(decodeSEXP);
+    rcpp_result_gen = Rcpp::wrap(s2_geography_unserialize(serialized, decode));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_prepare
+List cpp_s2_prepare(List geog, int maxEdgesPerCell, int numThreads);
+RcppExport SEXP _s2_cpp_s2_prepare(SEXP geogSEXP, SEXP maxEdgesPerCellSEXP, SEXP numThreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type geog(geogSEXP);
+    Rcpp::traits::input_parameter< int >::type maxEdgesPerCell(maxEdgesPerCellSEXP);
+    Rcpp::traits::input_parameter< int >::type numThreads(numThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_prepare(geog, maxEdgesPerCell, numThreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_memory_usage
+List cpp_s2_memory_usage(List geog);
+RcppExport SEXP _s2_cpp_s2_memory_usage(SEXP geogSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type geog(geogSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_memory_usage(geog));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_index_memory_budget
+List cpp_s2_index_memory_budget();
+RcppExport SEXP _s2_cpp_s2_index_memory_budget() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_index_memory_budget());
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_set_index_memory_budget
+void cpp_s2_set_index_memory_budget(double bytes);
+RcppExport SEXP _s2_cpp_s2_set_index_memory_budget(SEXP bytesSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< double >::type bytes(bytesSEXP);
+    cpp_s2_set_index_memory_budget(bytes);
+    return R_NilValue;
+END_RCPP
+}
 // s2_geography_format
 CharacterVector s2_geography_format(List s2_geography, int maxCoords, int precision, bool trim);
 RcppExport SEXP _s2_s2_geography_format(SEXP s2_geographySEXP, SEXP maxCoordsSEXP, SEXP precisionSEXP, SEXP trimSEXP) {
@@ -677,6 +1027,61 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// cpp_s2_region_terms
+List cpp_s2_region_terms(List geog, std::string prefix, int minLevel, int maxLevel, int levelMod, int maxCells, bool pointsOnly, bool optimizeForSpace, bool query, int numThreads);
+RcppExport SEXP _s2_cpp_s2_region_terms(SEXP geogSEXP, SEXP prefixSEXP, SEXP minLevelSEXP, SEXP maxLevelSEXP, SEXP levelModSEXP, SEXP maxCellsSEXP, SEXP pointsOnlySEXP, SEXP optimizeForSpaceSEXP, SEXP querySEXP, SEXP numThreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type geog(geogSEXP);
+    Rcpp::traits::input_parameter< std::string >::type prefix(prefixSEXP);
+    Rcpp::traits::input_parameter< int >::type minLevel(minLevelSEXP);
+    Rcpp::traits::input_parameter< int >::type maxLevel(maxLevelSEXP);
+    Rcpp::traits::input_parameter< int >::type levelMod(levelModSEXP);
+    Rcpp::traits::input_parameter< int >::type maxCells(maxCellsSEXP);
+    Rcpp::traits::input_parameter< bool >::type pointsOnly(pointsOnlySEXP);
+    Rcpp::traits::input_parameter< bool >::type optimizeForSpace(optimizeForSpaceSEXP);
+    Rcpp::traits::input_parameter< bool >::type query(querySEXP);
+    Rcpp::traits::input_parameter< int >::type numThreads(numThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_region_terms(geog, prefix, minLevel, maxLevel, levelMod, maxCells, pointsOnly, optimizeForSpace, query, numThreads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_index_write
+void cpp_s2_index_write(List geog, std::string file, int maxEdgesPerCell, int numThreads);
+RcppExport SEXP _s2_cpp_s2_index_write(SEXP geogSEXP, SEXP fileSEXP, SEXP maxEdgesPerCellSEXP, SEXP numThreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type geog(geogSEXP);
+    Rcpp::traits::input_parameter< std::string >::type file(fileSEXP);
+    Rcpp::traits::input_parameter< int >::type maxEdgesPerCell(maxEdgesPerCellSEXP);
+    Rcpp::traits::input_parameter< int >::type numThreads(numThreadsSEXP);
+    cpp_s2_index_write(geog, file, maxEdgesPerCell, numThreads);
+    return R_NilValue;
+END_RCPP
+}
+// cpp_s2_index_read
+SEXP cpp_s2_index_read(std::string file);
+RcppExport SEXP _s2_cpp_s2_index_read(SEXP fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type file(fileSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_index_read(file));
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_index_info
+List cpp_s2_index_info(SEXP index);
+RcppExport SEXP _s2_cpp_s2_index_info(SEXP indexSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type index(indexSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_index_info(index));
+    return rcpp_result_gen;
+END_RCPP
+}
 // s2_lnglat_from_numeric
 List s2_lnglat_from_numeric(NumericVector lng, NumericVector lat);
 RcppExport SEXP _s2_s2_lnglat_from_numeric(SEXP lngSEXP, SEXP latSEXP) {
@@ -712,51 +1117,68 @@ BEGIN_RCPP
 END_RCPP
 }
 // cpp_s2_closest_feature
-IntegerVector cpp_s2_closest_feature(List geog1, List geog2);
-RcppExport SEXP _s2_cpp_s2_closest_feature(SEXP geog1SEXP, SEXP geog2SEXP) {
+IntegerVector cpp_s2_closest_feature(List geog1, SEXP geog2, double maxError);
+RcppExport SEXP _s2_cpp_s2_closest_feature(SEXP geog1SEXP, SEXP geog2SEXP, SEXP maxErrorSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< List >::type geog1(geog1SEXP);
-    Rcpp::traits::input_parameter< List >::type geog2(geog2SEXP);
-    rcpp_result_gen = Rcpp::wrap(cpp_s2_closest_feature(geog1, geog2));
+    Rcpp::traits::input_parameter< SEXP >::type geog2(geog2SEXP);
+    Rcpp::traits::input_parameter< double >::type maxError(maxErrorSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_closest_feature(geog1, geog2, maxError));
     return rcpp_result_gen;
 END_RCPP
 }
 // cpp_s2_farthest_feature
-IntegerVector cpp_s2_farthest_feature(List geog1, List geog2);
-RcppExport SEXP _s2_cpp_s2_farthest_feature(SEXP geog1SEXP, SEXP geog2SEXP) {
+IntegerVector cpp_s2_farthest_feature(List geog1, SEXP geog2, double maxError);
+RcppExport SEXP _s2_cpp_s2_farthest_feature(SEXP geog1SEXP, SEXP geog2SEXP, SEXP maxErrorSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< List >::type geog1(geog1SEXP);
-    Rcpp::traits::input_parameter< List >::type geog2(geog2SEXP);
-    rcpp_result_gen = Rcpp::wrap(cpp_s2_farthest_feature(geog1, geog2));
+    Rcpp::traits::input_parameter< SEXP >::type geog2(geog2SEXP);
+    Rcpp::traits::input_parameter< double >::type maxError(maxErrorSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_farthest_feature(geog1, geog2, maxError));
     return rcpp_result_gen;
 END_RCPP
 }
 // cpp_s2_closest_edges
-List cpp_s2_closest_edges(List geog1, List geog2, int n, double min_distance);
+List cpp_s2_closest_edges(List geog1, SEXP geog2, int n, double min_distance);
 RcppExport SEXP _s2_cpp_s2_closest_edges(SEXP geog1SEXP, SEXP geog2SEXP, SEXP nSEXP, SEXP min_distanceSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< List >::type geog1(geog1SEXP);
-    Rcpp::traits::input_parameter< List >::type geog2(geog2SEXP);
+    Rcpp::traits::input_parameter< SEXP >::type geog2(geog2SEXP);
     Rcpp::traits::input_parameter< int >::type n(nSEXP);
     Rcpp::traits::input_parameter< double >::type min_distance(min_distanceSEXP);
     rcpp_result_gen = Rcpp::wrap(cpp_s2_closest_edges(geog1, geog2, n, min_distance));
     return rcpp_result_gen;
 END_RCPP
 }
+// cpp_s2_knn
+List cpp_s2_knn(List geog1, SEXP geog2, int k, double maxDistance, int numThreads);
+RcppExport SEXP _s2_cpp_s2_knn(SEXP geog1SEXP, SEXP geog2SEXP, SEXP kSEXP, SEXP maxDistanceSEXP, SEXP numThreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type geog1(geog1SEXP);
+    Rcpp::traits::input_parameter< SEXP >::type geog2(geog2SEXP);
+    Rcpp::traits::input_parameter< int >::type k(kSEXP);
+    Rcpp::traits::input_parameter< double >::type maxDistance(maxDistanceSEXP);
+    Rcpp::traits::input_parameter< int >::type numThreads(numThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_knn(geog1, geog2, k, maxDistance, numThreads));
+    return rcpp_result_gen;
+END_RCPP
+}
 // cpp_s2_may_intersect_matrix
-List cpp_s2_may_intersect_matrix(List geog1, List geog2, int maxEdgesPerCell, int maxFeatureCells, List s2options);
+List cpp_s2_may_intersect_matrix(List geog1, SEXP geog2, int maxEdgesPerCell, int maxFeatureCells, List s2options);
 RcppExport SEXP _s2_cpp_s2_may_intersect_matrix(SEXP geog1SEXP, SEXP geog2SEXP, SEXP maxEdgesPerCellSEXP, SEXP maxFeatureCellsSEXP, SEXP s2optionsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< List >::type geog1(geog1SEXP);
-    Rcpp::traits::input_parameter< List >::type geog2(geog2SEXP);
+    Rcpp::traits::input_parameter< SEXP >::type geog2(geog2SEXP);
     Rcpp::traits::input_parameter< int >::type maxEdgesPerCell(maxEdgesPerCellSEXP);
     Rcpp::traits::input_parameter< int >::type maxFeatureCells(maxFeatureCellsSEXP);
     Rcpp::traits::input_parameter< List >::type s2options(s2optionsSEXP);
@@ -765,104 +1187,121 @@ BEGIN_RCPP
 END_RCPP
 }
 // cpp_s2_contains_matrix
-List cpp_s2_contains_matrix(List geog1, List geog2, List s2options);
+List cpp_s2_contains_matrix(List geog1, SEXP geog2, List s2options);
 RcppExport SEXP _s2_cpp_s2_contains_matrix(SEXP geog1SEXP, SEXP geog2SEXP, SEXP s2optionsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< List >::type geog1(geog1SEXP);
-    Rcpp::traits::input_parameter< List >::type geog2(geog2SEXP);
+    Rcpp::traits::input_parameter< SEXP >::type geog2(geog2SEXP);
     Rcpp::traits::input_parameter< List >::type s2options(s2optionsSEXP);
     rcpp_result_gen = Rcpp::wrap(cpp_s2_contains_matrix(geog1, geog2, s2options));
     return rcpp_result_gen;
 END_RCPP
 }
 // cpp_s2_within_matrix
-List cpp_s2_within_matrix(List geog1, List geog2, List s2options);
+List cpp_s2_within_matrix(List geog1, SEXP geog2, List s2options);
 RcppExport SEXP _s2_cpp_s2_within_matrix(SEXP geog1SEXP, SEXP geog2SEXP, SEXP s2optionsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< List >::type geog1(geog1SEXP);
-    Rcpp::traits::input_parameter< List >::type geog2(geog2SEXP);
+    Rcpp::traits::input_parameter< SEXP >::type geog2(geog2SEXP);
     Rcpp::traits::input_parameter< List >::type s2options(s2optionsSEXP);
     rcpp_result_gen = Rcpp::wrap(cpp_s2_within_matrix(geog1, geog2, s2options));
     return rcpp_result_gen;
 END_RCPP
 }
 // cpp_s2_intersects_matrix
-List cpp_s2_intersects_matrix(List geog1, List geog2, List s2options);
+List cpp_s2_intersects_matrix(List geog1, SEXP geog2, List s2options);
 RcppExport SEXP _s2_cpp_s2_intersects_matrix(SEXP geog1SEXP, SEXP geog2SEXP, SEXP s2optionsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< List >::type geog1(geog1SEXP);
-    Rcpp::traits::input_parameter< List >::type geog2(geog2SEXP);
+    Rcpp::traits::input_parameter< SEXP >::type geog2(geog2SEXP);
     Rcpp::traits::input_parameter< List >::type s2options(s2optionsSEXP);
     rcpp_result_gen = Rcpp::wrap(cpp_s2_intersects_matrix(geog1, geog2, s2options));
     return rcpp_result_gen;
 END_RCPP
 }
 // cpp_s2_equals_matrix
-List cpp_s2_equals_matrix(List geog1, List geog2, List s2options);
+List cpp_s2_equals_matrix(List geog1, SEXP geog2, List s2options);
 RcppExport SEXP _s2_cpp_s2_equals_matrix(SEXP geog1SEXP, SEXP geog2SEXP, SEXP s2optionsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< List >::type geog1(geog1SEXP);
-    Rcpp::traits::input_parameter< List >::type geog2(geog2SEXP);
+    Rcpp::traits::input_parameter< SEXP >::type geog2(geog2SEXP);
     Rcpp::traits::input_parameter< List >::type s2options(s2optionsSEXP);
     rcpp_result_gen = Rcpp::wrap(cpp_s2_equals_matrix(geog1, geog2, s2options));
     return rcpp_result_gen;
 END_RCPP
 }
 // cpp_s2_touches_matrix
-List cpp_s2_touches_matrix(List geog1, List geog2, List s2options);
+List cpp_s2_touches_matrix(List geog1, SEXP geog2, List s2options);
 RcppExport SEXP _s2_cpp_s2_touches_matrix(SEXP geog1SEXP, SEXP geog2SEXP, SEXP s2optionsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< List >::type geog1(geog1SEXP);
-    Rcpp::traits::input_parameter< List >::type geog2(geog2SEXP);
+    Rcpp::traits::input_parameter< SEXP >::type geog2(geog2SEXP);
     Rcpp::traits::input_parameter< List >::type s2options(s2optionsSEXP);
     rcpp_result_gen = Rcpp::wrap(cpp_s2_touches_matrix(geog1, geog2, s2options));
     return rcpp_result_gen;
 END_RCPP
 }
+// cpp_s2_relate_matrix
+List cpp_s2_relate_matrix(List geog1, SEXP geog2, List s2options);
+RcppExport SEXP _s2_cpp_s2_relate_matrix(SEXP geog1SEXP, SEXP geog2SEXP, SEXP s2optionsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type geog1(geog1SEXP);
+    Rcpp::traits::input_parameter< SEXP >::type geog2(geog2SEXP);
+    Rcpp::traits::input_parameter< List >::type s2options(s2optionsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_relate_matrix(geog1, geog2, s2options));
+    return rcpp_result_gen;
+END_RCPP
+}
 // cpp_s2_dwithin_matrix
-List cpp_s2_dwithin_matrix(List geog1, List geog2, double distance);
+List cpp_s2_dwithin_matrix(List geog1, SEXP geog2, double distance);
 RcppExport SEXP _s2_cpp_s2_dwithin_matrix(SEXP geog1SEXP, SEXP geog2SEXP, SEXP distanceSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< List >::type geog1(geog1SEXP);
-    Rcpp::traits::input_parameter< List >::type geog2(geog2SEXP);
+    Rcpp::traits::input_parameter< SEXP >::type geog2(geog2SEXP);
     Rcpp::traits::input_parameter< double >::type distance(distanceSEXP);
     rcpp_result_gen = Rcpp::wrap(cpp_s2_dwithin_matrix(geog1, geog2, distance));
     return rcpp_result_gen;
 END_RCPP
 }
 // cpp_s2_distance_matrix
-NumericMatrix cpp_s2_distance_matrix(List geog1, List geog2);
-RcppExport SEXP _s2_cpp_s2_distance_matrix(SEXP geog1SEXP, SEXP geog2SEXP) {
+NumericMatrix cpp_s2_distance_matrix(List geog1, SEXP geog2, double maxError, int numThreads);
+RcppExport SEXP _s2_cpp_s2_distance_matrix(SEXP geog1SEXP, SEXP geog2SEXP, SEXP maxErrorSEXP, SEXP numThreadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< List >::type geog1(geog1SEXP);
-    Rcpp::traits::input_parameter< List >::type geog2(geog2SEXP);
-    rcpp_result_gen = Rcpp::wrap(cpp_s2_distance_matrix(geog1, geog2));
+    Rcpp::traits::input_parameter< SEXP >::type geog2(geog2SEXP);
+    Rcpp::traits::input_parameter< double >::type maxError(maxErrorSEXP);
+    Rcpp::traits::input_parameter< int >::type numThreads(numThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_distance_matrix(geog1, geog2, maxError, numThreads));
     return rcpp_result_gen;
 END_RCPP
 }
 // cpp_s2_max_distance_matrix
-NumericMatrix cpp_s2_max_distance_matrix(List geog1, List geog2);
-RcppExport SEXP _s2_cpp_s2_max_distance_matrix(SEXP geog1SEXP, SEXP geog2SEXP) {
+NumericMatrix cpp_s2_max_distance_matrix(List geog1, SEXP geog2, double maxError, int numThreads);
+RcppExport SEXP _s2_cpp_s2_max_distance_matrix(SEXP geog1SEXP, SEXP geog2SEXP, SEXP maxErrorSEXP, SEXP numThreadsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< List >::type geog1(geog1SEXP);
-    Rcpp::traits::input_parameter< List >::type geog2(geog2SEXP);
-    rcpp_result_gen = Rcpp::wrap(cpp_s2_max_distance_matrix(geog1, geog2));
+    Rcpp::traits::input_parameter< SEXP >::type geog2(geog2SEXP);
+    Rcpp::traits::input_parameter< double >::type maxError(maxErrorSEXP);
+    Rcpp::traits::input_parameter< int >::type numThreads(numThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_max_distance_matrix(geog1, geog2, maxError, numThreads));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -1018,6 +1457,19 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// cpp_s2_relate
+IntegerVector cpp_s2_relate(List geog1, List geog2, List s2options);
+RcppExport SEXP _s2_cpp_s2_relate(SEXP geog1SEXP, SEXP geog2SEXP, SEXP s2optionsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type geog1(geog1SEXP);
+    Rcpp::traits::input_parameter< List >::type geog2(geog2SEXP);
+    Rcpp::traits::input_parameter< List >::type s2options(s2optionsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_relate(geog1, geog2, s2options));
+    return rcpp_result_gen;
+END_RCPP
+}
 // cpp_s2_dwithin
 LogicalVector cpp_s2_dwithin(List geog1, List geog2, NumericVector distance);
 RcppExport SEXP _s2_cpp_s2_dwithin(SEXP geog1SEXP, SEXP geog2SEXP, SEXP distanceSEXP) {
@@ -1048,6 +1500,45 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// cpp_s2_profile
+List cpp_s2_profile();
+RcppExport SEXP _s2_cpp_s2_profile() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_profile());
+    return rcpp_result_gen;
+END_RCPP
+}
+// cpp_s2_profile_reset
+void cpp_s2_profile_reset(bool enabled);
+RcppExport SEXP _s2_cpp_s2_profile_reset(SEXP enabledSEXP) {
+BEGIN_RCPP
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< bool >::type enabled(enabledSEXP);
+    cpp_s2_profile_reset(enabled);
+    return R_NilValue;
+END_RCPP
+}
+// cpp_s2_random
+List cpp_s2_random(int n, int dimension, int numVertices, double fractalDimension, int numClusters, double clusterRadius, double overlap, double size, int numThreads);
+RcppExport SEXP _s2_cpp_s2_random(SEXP nSEXP, SEXP dimensionSEXP, SEXP numVerticesSEXP, SEXP fractalDimensionSEXP, SEXP numClustersSEXP, SEXP clusterRadiusSEXP, SEXP overlapSEXP, SEXP sizeSEXP, SEXP numThreadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type n(nSEXP);
+    Rcpp::traits::input_parameter< int >::type dimension(dimensionSEXP);
+    Rcpp::traits::input_parameter< int >::type numVertices(numVerticesSEXP);
+    Rcpp::traits::input_parameter< double >::type fractalDimension(fractalDimensionSEXP);
+    Rcpp::traits::input_parameter< int >::type numClusters(numClustersSEXP);
+    Rcpp::traits::input_parameter< double >::type clusterRadius(clusterRadiusSEXP);
+    Rcpp::traits::input_parameter< double >::type overlap(overlapSEXP);
+    Rcpp::traits::input_parameter< double >::type size(sizeSEXP);
+    Rcpp::traits::input_parameter< int >::type numThreads(numThreadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(cpp_s2_random(n, dimension, numVertices, fractalDimension, numClusters, clusterRadius, overlap, size, numThreads));
+    return rcpp_result_gen;
+END_RCPP
+}
 // cpp_s2_intersection
 List cpp_s2_intersection(List geog1, List geog2, List s2options);
 RcppExport SEXP _s2_cpp_s2_intersection(SEXP geog1SEXP, SEXP geog2SEXP, SEXP s2optionsSEXP) {
@@ -1287,18 +1778,32 @@ static const R_CallMethodDef CallEntries[] = {
     {"_s2_cpp_s2_x", (DL_FUNC) &_s2_cpp_s2_x, 1},
     {"_s2_cpp_s2_y", (DL_FUNC) &_s2_cpp_s2_y, 1},
     {"_s2_cpp_s2_project_normalized", (DL_FUNC) &_s2_cpp_s2_project_normalized, 2},
-    {"_s2_cpp_s2_distance", (DL_FUNC) &_s2_cpp_s2_distance, 2},
-    {"_s2_cpp_s2_max_distance", (DL_FUNC) &_s2_cpp_s2_max_distance, 2},
+    {"_s2_cpp_s2_distance", (DL_FUNC) &_s2_cpp_s2_distance, 3},
+    {"_s2_cpp_s2_max_distance", (DL_FUNC) &_s2_cpp_s2_max_distance, 3},
     {"_s2_cpp_s2_bounds_cap", (DL_FUNC) &_s2_cpp_s2_bounds_cap, 1},
     {"_s2_cpp_s2_bounds_rect", (DL_FUNC) &_s2_cpp_s2_bounds_rect, 1},
+    {"_s2_cpp_s2_covering", (DL_FUNC) &_s2_cpp_s2_covering, 7},
+    {"_s2_cpp_s2_cell_union_normalize", (DL_FUNC) &_s2_cpp_s2_cell_union_normalize, 1},
+    {"_s2_cpp_s2_cell_union_from_cell", (DL_FUNC) &_s2_cpp_s2_cell_union_from_cell, 1},
+    {"_s2_cpp_s2_cell_union_union", (DL_FUNC) &_s2_cpp_s2_cell_union_union, 2},
+    {"_s2_cpp_s2_cell_union_intersection", (DL_FUNC) &_s2_cpp_s2_cell_union_intersection, 2},
+    {"_s2_cpp_s2_cell_union_difference", (DL_FUNC) &_s2_cpp_s2_cell_union_difference, 2},
+    {"_s2_cpp_s2_cell_union_contains", (DL_FUNC) &_s2_cpp_s2_cell_union_contains, 2},
+    {"_s2_cpp_s2_cell_union_intersects", (DL_FUNC) &_s2_cpp_s2_cell_union_intersects, 2},
+    {"_s2_cpp_s2_cell_union_contains_cell", (DL_FUNC) &_s2_cpp_s2_cell_union_contains_cell, 2},
+    {"_s2_cpp_s2_cell_union_intersects_cell", (DL_FUNC) &_s2_cpp_s2_cell_union_intersects_cell, 2},
+    {"_s2_cpp_s2_cell_union_area", (DL_FUNC) &_s2_cpp_s2_cell_union_area, 1},
+    {"_s2_cpp_s2_geography_from_cell_union", (DL_FUNC) &_s2_cpp_s2_geography_from_cell_union, 1},
     {"_s2_cpp_s2_cell_sentinel", (DL_FUNC) &_s2_cpp_s2_cell_sentinel, 0},
     {"_s2_cpp_s2_cell_from_string", (DL_FUNC) &_s2_cpp_s2_cell_from_string, 1},
-    {"_s2_cpp_s2_cell_from_lnglat", (DL_FUNC) &_s2_cpp_s2_cell_from_lnglat, 1},
+    {"_s2_cpp_s2_cell_from_lnglat", (DL_FUNC) &_s2_cpp_s2_cell_from_lnglat, 3},
     {"_s2_cpp_s2_cell_to_lnglat", (DL_FUNC) &_s2_cpp_s2_cell_to_lnglat, 1},
     {"_s2_cpp_s2_cell_is_na", (DL_FUNC) &_s2_cpp_s2_cell_is_na, 1},
-    {"_s2_cpp_s2_cell_sort", (DL_FUNC) &_s2_cpp_s2_cell_sort, 2},
+    {"_s2_cpp_s2_cell_sort", (DL_FUNC) &_s2_cpp_s2_cell_sort, 3},
     {"_s2_cpp_s2_cell_range", (DL_FUNC) &_s2_cpp_s2_cell_range, 2},
-    {"_s2_cpp_s2_cell_unique", (DL_FUNC) &_s2_cpp_s2_cell_unique, 1},
+    {"_s2_cpp_s2_cell_unique", (DL_FUNC) &_s2_cpp_s2_cell_unique, 2},
+    {"_s2_cpp_s2_cell_count", (DL_FUNC) &_s2_cpp_s2_cell_count, 2},
+    {"_s2_cpp_s2_cell_bin", (DL_FUNC) &_s2_cpp_s2_cell_bin, 5},
     {"_s2_cpp_s2_cell_to_string", (DL_FUNC) &_s2_cpp_s2_cell_to_string, 1},
     {"_s2_cpp_s2_cell_debug_string", (DL_FUNC) &_s2_cpp_s2_cell_debug_string, 1},
     {"_s2_cpp_s2_cell_is_valid", (DL_FUNC) &_s2_cpp_s2_cell_is_valid, 1},
@@ -1309,8 +1814,12 @@ static const R_CallMethodDef CallEntries[] = {
     {"_s2_cpp_s2_cell_area", (DL_FUNC) &_s2_cpp_s2_cell_area, 1},
     {"_s2_cpp_s2_cell_area_approx", (DL_FUNC) &_s2_cpp_s2_cell_area_approx, 1},
     {"_s2_cpp_s2_cell_parent", (DL_FUNC) &_s2_cpp_s2_cell_parent, 2},
+    {"_s2_cpp_s2_cell_range_min", (DL_FUNC) &_s2_cpp_s2_cell_range_min, 1},
+    {"_s2_cpp_s2_cell_range_max", (DL_FUNC) &_s2_cpp_s2_cell_range_max, 1},
     {"_s2_cpp_s2_cell_child", (DL_FUNC) &_s2_cpp_s2_cell_child, 2},
     {"_s2_cpp_s2_cell_edge_neighbour", (DL_FUNC) &_s2_cpp_s2_cell_edge_neighbour, 2},
+    {"_s2_cpp_s2_cell_k_ring", (DL_FUNC) &_s2_cpp_s2_cell_k_ring, 3},
+    {"_s2_cpp_s2_cell_disk", (DL_FUNC) &_s2_cpp_s2_cell_disk, 3},
     {"_s2_cpp_s2_cell_cummax", (DL_FUNC) &_s2_cpp_s2_cell_cummax, 1},
     {"_s2_cpp_s2_cell_cummin", (DL_FUNC) &_s2_cpp_s2_cell_cummin, 1},
     {"_s2_cpp_s2_cell_eq", (DL_FUNC) &_s2_cpp_s2_cell_eq, 2},
@@ -1326,27 +1835,44 @@ static const R_CallMethodDef CallEntries[] = {
     {"_s2_cpp_s2_geog_point", (DL_FUNC) &_s2_cpp_s2_geog_point, 2},
     {"_s2_cpp_s2_make_line", (DL_FUNC) &_s2_cpp_s2_make_line, 3},
     {"_s2_cpp_s2_make_polygon", (DL_FUNC) &_s2_cpp_s2_make_polygon, 6},
+    {"_s2_cpp_s2_feature_index", (DL_FUNC) &_s2_cpp_s2_feature_index, 1},
+    {"_s2_cpp_s2_feature_index_append", (DL_FUNC) &_s2_cpp_s2_feature_index_append, 2},
+    {"_s2_cpp_s2_feature_index_remove", (DL_FUNC) &_s2_cpp_s2_feature_index_remove, 2},
+    {"_s2_cpp_s2_feature_index_ids", (DL_FUNC) &_s2_cpp_s2_feature_index_ids, 1},
+    {"_s2_cpp_s2_feature_index_info", (DL_FUNC) &_s2_cpp_s2_feature_index_info, 1},
     {"_s2_s2_geography_from_wkb", (DL_FUNC) &_s2_s2_geography_from_wkb, 3},
     {"_s2_s2_geography_from_wkt", (DL_FUNC) &_s2_s2_geography_from_wkt, 3},
     {"_s2_s2_geography_full", (DL_FUNC) &_s2_s2_geography_full, 1},
     {"_s2_s2_geography_to_wkt", (DL_FUNC) &_s2_s2_geography_to_wkt, 3},
     {"_s2_s2_geography_to_wkb", (DL_FUNC) &_s2_s2_geography_to_wkb, 2},
+    {"_s2_s2_geography_serialize", (DL_FUNC) &_s2_s2_geography_serialize, 2},
+    {"_s2_s2_geography_unserialize", (DL_FUNC) &_s2_s2_geography_unserialize, 2},
+    {"_s2_cpp_s2_prepare", (DL_FUNC) &_s2_cpp_s2_prepare, 3},
+    {"_s2_cpp_s2_memory_usage", (DL_FUNC) &_s2_cpp_s2_memory_usage, 1},
+    {"_s2_cpp_s2_index_memory_budget", (DL_FUNC) &_s2_cpp_s2_index_memory_budget, 0},
+    {"_s2_cpp_s2_set_index_memory_budget", (DL_FUNC) &_s2_cpp_s2_set_index_memory_budget, 1},
     {"_s2_s2_geography_format", (DL_FUNC) &_s2_s2_geography_format, 4},
+    {"_s2_cpp_s2_region_terms", (DL_FUNC) &_s2_cpp_s2_region_terms, 10},
+    {"_s2_cpp_s2_index_write", (DL_FUNC) &_s2_cpp_s2_index_write, 4},
+    {"_s2_cpp_s2_index_read", (DL_FUNC) &_s2_cpp_s2_index_read, 1},
+    {"_s2_cpp_s2_index_info", (DL_FUNC) &_s2_cpp_s2_index_info, 1},
     {"_s2_s2_lnglat_from_numeric", (DL_FUNC) &_s2_s2_lnglat_from_numeric, 2},
     {"_s2_s2_lnglat_from_s2_point", (DL_FUNC) &_s2_s2_lnglat_from_s2_point, 1},
     {"_s2_data_frame_from_s2_lnglat", (DL_FUNC) &_s2_data_frame_from_s2_lnglat, 1},
-    {"_s2_cpp_s2_closest_feature", (DL_FUNC) &_s2_cpp_s2_closest_feature, 2},
-    {"_s2_cpp_s2_farthest_feature", (DL_FUNC) &_s2_cpp_s2_farthest_feature, 2},
+    {"_s2_cpp_s2_closest_feature", (DL_FUNC) &_s2_cpp_s2_closest_feature, 3},
+    {"_s2_cpp_s2_farthest_feature", (DL_FUNC) &_s2_cpp_s2_farthest_feature, 3},
     {"_s2_cpp_s2_closest_edges", (DL_FUNC) &_s2_cpp_s2_closest_edges, 4},
+    {"_s2_cpp_s2_knn", (DL_FUNC) &_s2_cpp_s2_knn, 5},
     {"_s2_cpp_s2_may_intersect_matrix", (DL_FUNC) &_s2_cpp_s2_may_intersect_matrix, 5},
     {"_s2_cpp_s2_contains_matrix", (DL_FUNC) &_s2_cpp_s2_contains_matrix, 3},
     {"_s2_cpp_s2_within_matrix", (DL_FUNC) &_s2_cpp_s2_within_matrix, 3},
     {"_s2_cpp_s2_intersects_matrix", (DL_FUNC) &_s2_cpp_s2_intersects_matrix, 3},
     {"_s2_cpp_s2_equals_matrix", (DL_FUNC) &_s2_cpp_s2_equals_matrix, 3},
     {"_s2_cpp_s2_touches_matrix", (DL_FUNC) &_s2_cpp_s2_touches_matrix, 3},
+    {"_s2_cpp_s2_relate_matrix", (DL_FUNC) &_s2_cpp_s2_relate_matrix, 3},
     {"_s2_cpp_s2_dwithin_matrix", (DL_FUNC) &_s2_cpp_s2_dwithin_matrix, 3},
-    {"_s2_cpp_s2_distance_matrix", (DL_FUNC) &_s2_cpp_s2_distance_matrix, 2},
-    {"_s2_cpp_s2_max_distance_matrix", (DL_FUNC) &_s2_cpp_s2_max_distance_matrix, 2},
+    {"_s2_cpp_s2_distance_matrix", (DL_FUNC) &_s2_cpp_s2_distance_matrix, 4},
+    {"_s2_cpp_s2_max_distance_matrix", (DL_FUNC) &_s2_cpp_s2_max_distance_matrix, 4},
     {"_s2_cpp_s2_contains_matrix_brute_force", (DL_FUNC) &_s2_cpp_s2_contains_matrix_brute_force, 3},
     {"_s2_cpp_s2_within_matrix_brute_force", (DL_FUNC) &_s2_cpp_s2_within_matrix_brute_force, 3},
     {"_s2_cpp_s2_intersects_matrix_brute_force", (DL_FUNC) &_s2_cpp_s2_intersects_matrix_brute_force, 3},
@@ -1359,8 +1885,12 @@ static const R_CallMethodDef CallEntries[] = {
     {"_s2_cpp_s2_equals", (DL_FUNC) &_s2_cpp_s2_equals, 3},
     {"_s2_cpp_s2_contains", (DL_FUNC) &_s2_cpp_s2_contains, 3},
     {"_s2_cpp_s2_touches", (DL_FUNC) &_s2_cpp_s2_touches, 3},
+    {"_s2_cpp_s2_relate", (DL_FUNC) &_s2_cpp_s2_relate, 3},
     {"_s2_cpp_s2_dwithin", (DL_FUNC) &_s2_cpp_s2_dwithin, 3},
     {"_s2_cpp_s2_intersects_box", (DL_FUNC) &_s2_cpp_s2_intersects_box, 7},
+    {"_s2_cpp_s2_profile", (DL_FUNC) &_s2_cpp_s2_profile, 0},
+    {"_s2_cpp_s2_profile_reset", (DL_FUNC) &_s2_cpp_s2_profile_reset, 1},
+    {"_s2_cpp_s2_random", (DL_FUNC) &_s2_cpp_s2_random, 9},
     {"_s2_cpp_s2_intersection", (DL_FUNC) &_s2_cpp_s2_intersection, 3},
     {"_s2_cpp_s2_union", (DL_FUNC) &_s2_cpp_s2_union, 3},
     {"_s2_cpp_s2_difference", (DL_FUNC) &_s2_cpp_s2_difference, 3},
@@ -0,0 +1,488 @@
+
+#ifndef GEOGRAPHY_CODING_H
+#define GEOGRAPHY_CODING_H
+
+#include <array>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <string>
+
+#include "s2/encoded_s2point_vector.h"
+#include "s2/s2coords.h"
+#include "s2/s2lax_polygon_shape.h"
+#include "s2/s2lax_polyline_shape.h"
+#include "s2/s2point_compression.h"
+#include "s2/s2point_vector_shape.h"
+#include "s2/s2shapeutil_coding.h"
+#include "s2/util/coding/coder.h"
+
+#include "geography.h"
+#include "point-geography.h"
+#include "polyline-geography.h"
+#include "polygon-geography.h"
+#include "geography-collection.h"
+
+#include <Rcpp.h>
+
+// A compact binary representation of a Geography based on the encoders
+// in the S2 library. Unlike WKB, decoding doesn't require validating or
+// re-normalizing the input, and the shape index can optionally be encoded
+// so that it doesn't have to be rebuilt after decoding. Vertices that are
+// snapped to S2 cell centers (e.g., using s2_rebuild() with s2_snap_level())
+// are stored in a compressed form by all three geometry types. The layout is:
+//
+// - byte: encoding version
+// - byte: flags (GeographyEncoder::FLAG_INDEX if the index follows the geography)
+// - geography: a byte for the Geography::Type followed by
+//   - point: EncodeS2PointVector()
+//   - polyline: varint32 number of polylines, a polyline for each
+//     (see EncodePolyline())
+//   - polygon: S2Polygon::Encode()
+//   - collection: varint32 number of features, a geography for each
+// - index: MutableS2ShapeIndex::Encode() (if FLAG_INDEX is set)
+class GeographyEncoder {
+  friend class EncodedGeography;
+
+public:
+  static const unsigned char VERSION = 1;
+  static const unsigned char FLAG_INDEX = 1;
+
+  static void Encode(Geography* geog, Encoder* encoder, bool includeIndex) {
+    encoder->Ensure(2);
+    encoder->put8(VERSION);
+    encoder->put8(includeIndex ? FLAG_INDEX : 0);
+    EncodeGeography(geog, encoder);
+    if (includeIndex) {
+      geog->EncodeShapeIndex(encoder);
+    }
+  }
+
+  // returns nullptr if the input could not be decoded
+  static std::unique_ptr<Geography> Decode(Decoder* decoder) {
+    if (decoder->avail() < 2 || decoder->get8() != VERSION) {
+      return nullptr;
+    }
+
+    unsigned char flags = decoder->get8();
+    std::unique_ptr<Geography> geog = DecodeGeography(decoder);
+    if (!geog) {
+      return nullptr;
+    }
+
+    if ((flags & FLAG_INDEX) && !geog->DecodeShapeIndex(decoder)) {
+      return nullptr;
+    }
+
+    return geog;
+  }
+
+private:
+  static void EncodeGeography(Geography* feature, Encoder* encoder) {
+    DecodedGeography geog(feature);
+    Geography::Type type = geog->GeographyType();
+    encoder->Ensure(1);
+    encoder->put8(static_cast<unsigned char>(type));
+
+    switch (type) {
+    case Geography::Type::GEOGRAPHY_POINT:
+      EncodeS2PointVector(*geog->Point(), s2coding::CodingHint::COMPACT, encoder);
+      break;
+
+    case Geography::Type::GEOGRAPHY_POLYLINE: {
+      const std::vector<std::unique_ptr<S2Polyline>>* polylines = geog->Polyline();
+      encoder->Ensure(Varint::kMax32);
+      encoder->put_varint32(polylines->size());
+      for (const auto& polyline: *polylines) {
+        EncodePolyline(*polyline, encoder);
+      }
+      break;
+    }
+
+    case Geography::Type::GEOGRAPHY_POLYGON: {
+      const S2Polygon* polygon = geog->Polygon();
+      if (polygon == nullptr) {
+        S2Polygon().Encode(encoder);
+      } else {
+        polygon->Encode(encoder);
+      }
+      break;
+    }
+
+    case Geography::Type::GEOGRAPHY_COLLECTION: {
+      GeographyCollection* collection = dynamic_cast<GeographyCollection*>(geog.get());
+      const std::vector<std::unique_ptr<Geography>>& features = collection->Features();
+      encoder->Ensure(Varint::kMax32);
+      encoder->put_varint32(features.size());
+      for (const auto& feature: features) {
+        EncodeGeography(feature.get(), encoder);
+      }
+      break;
+    }
+
+    default:
+      Rcpp::stop("Can't encode geography of unknown type");
+    }
+  }
+
+  // S2Polyline::Encode() is always lossless, so polylines whose vertices are
+  // mostly snapped to cell centers at one level are encoded with
+  // S2EncodePointsCompressed() instead (using the same heuristic as
+  // S2Polygon::Encode()). The layout is a byte containing the snap level + 1
+  // (or 0 for S2Polyline::Encode()) followed by either a varint32 number of
+  // vertices and the compressed vertices or S2Polyline::Encode().
+  static void EncodePolyline(const S2Polyline& polyline, Encoder* encoder) {
+    int numVertices = polyline.num_vertices();
+    std::vector<S2XYZFaceSiTi> vertices(numVertices);
+    std::array<int, S2::kMaxCellLevel + 2> histogram;
+    histogram.fill(0);
+    for (int i = 0; i < numVertices; i++) {
+      vertices[i].xyz = polyline.vertex(i);
+      vertices[i].cell_level = S2::XYZtoFaceSiTi(
+        vertices[i].xyz, &vertices[i].face, &vertices[i].si, &vertices[i].ti
+      );
+      histogram[vertices[i].cell_level + 1]++;
+    }
+
+    auto maxLevel = std::max_element(histogram.begin() + 1, histogram.end());
+    int snapLevel = maxLevel - (histogram.begin() + 1);
+    int numUnsnapped = numVertices - *maxLevel;
+    int compressedSize = 4 * numVertices + (sizeof(S2Point) + 2) * numUnsnapped;
+    int losslessSize = sizeof(S2Point) * numVertices;
+
+    encoder->Ensure(1 + Varint::kMax32);
+    if (numVertices > 0 && compressedSize < losslessSize) {
+      encoder->put8(snapLevel + 1);
+      encoder->put_varint32(numVertices);
+      S2EncodePointsCompressed(vertices, snapLevel, encoder);
+    } else {
+      encoder->put8(0);
+      polyline.Encode(encoder);
+    }
+  }
+
+  static std::unique_ptr<S2Polyline> DecodePolyline(Decoder* decoder) {
+    if (decoder->avail() < 1) {
+      return nullptr;
+    }
+
+    int snapLevel = static_cast<int>(decoder->get8()) - 1;
+    if (snapLevel > S2::kMaxCellLevel) {
+      return nullptr;
+    }
+
+    if (snapLevel < 0) {
+      std::unique_ptr<S2Polyline> polyline = absl::make_unique<S2Polyline>();
+      polyline->set_s2debug_override(S2Debug::DISABLE);
+      if (!polyline->Decode(decoder)) {
+        return nullptr;
+      }
+
+      return polyline;
+    }
+
+    uint32 numVertices;
+    if (!decoder->get_varint32(&numVertices) || numVertices > decoder->avail()) {
+      return nullptr;
+    }
+
+    std::vector<S2Point> vertices(numVertices);
+    if (!S2DecodePointsCompressed(decoder, snapLevel, absl::MakeSpan(vertices))) {
+      return nullptr;
+    }
+
+    return absl::make_unique<S2Polyline>(vertices, S2Debug::DISABLE);
+  }
+
+  static std::unique_ptr<Geography> DecodeGeography(Decoder* decoder) {
+    if (decoder->avail() < 1) {
+      return nullptr;
+    }
+
+    Geography::Type type = static_cast<Geography::Type>(decoder->get8());
+
+    switch (type) {
+    case Geography::Type::GEOGRAPHY_POINT: {
+      s2coding::EncodedS2PointVector points;
+      if (!points.Init(decoder)) {
+        return nullptr;
+      }
+
+      return absl::make_unique<PointGeography>(points.Decode());
+    }
+
+    case Geography::Type::GEOGRAPHY_POLYLINE: {
+      uint32 size;
+      if (!decoder->get_varint32(&size)) {
+        return nullptr;
+      }
+
+      std::vector<std::unique_ptr<S2Polyline>> polylines(size);
+      for (uint32 i = 0; i < size; i++) {
+        polylines[i] = DecodePolyline(decoder);
+        if (!polylines[i]) {
+          return nullptr;
+        }
+      }
+
+      return absl::make_unique<PolylineGeography>(std::move(polylines));
+    }
+
+    case Geography::Type::GEOGRAPHY_POLYGON: {
+      std::unique_ptr<S2Polygon> polygon = absl::make_unique<S2Polygon>();
+      polygon->set_s2debug_override(S2Debug::DISABLE);
+      if (!polygon->Decode(decoder)) {
+        return nullptr;
+      }
+
+      return absl::make_unique<PolygonGeography>(std::move(polygon));
+    }
+
+    case Geography::Type::GEOGRAPHY_COLLECTION: {
+      uint32 size;
+      if (!decoder->get_varint32(&size)) {
+        return nullptr;
+      }
+
+      std::vector<std::unique_ptr<Geography>> features(size);
+      for (uint32 i = 0; i < size; i++) {
+        features[i] = DecodeGeography(decoder);
+        if (!features[i]) {
+          return nullptr;
+        }
+      }
+
+      return absl::make_unique<GeographyCollection>(std::move(features));
+    }
+
+    default:
+      return nullptr;
+    }
+  }
+};
+
+// A Geography that keeps the output of GeographyEncoder::Encode() (e.g., an
+// element of s2_geog_serialize()) instead of decoded S2 objects, so that its
+// vertices stay compressed if they were snapped to cell centers. Accessors
+// decode a temporary copy of the feature, and the shape index is built from
+// compact encodings of S2LaxPolygonShape, S2LaxPolylineShape, and
+// S2PointVectorShape whose vertices are decoded as edges are visited (as
+// in an EncodedS2ShapeIndex). The encoded bytes are not copied and must
+// outlive the feature.
+class EncodedGeography: public Geography {
+public:
+  // Returns nullptr if data can't be decoded. An encoded shape index is
+  // ignored (the index is built from lazily decoded shapes instead).
+  static std::unique_ptr<EncodedGeography> Create(const char* data, size_t size) {
+    Decoder decoder(data, size);
+    if (decoder.avail() < 2 || decoder.get8() != GeographyEncoder::VERSION) {
+      return nullptr;
+    }
+
+    unsigned char flags = decoder.get8();
+    const char* start = reinterpret_cast<const char*>(decoder.ptr());
+    std::unique_ptr<Geography> decoded = GeographyEncoder::DecodeGeography(&decoder);
+    if (!decoded || (!(flags & GeographyEncoder::FLAG_INDEX) && decoder.avail() != 0)) {
+      return nullptr;
+    }
+
+    size_t geographySize = reinterpret_cast<const char*>(decoder.ptr()) - start;
+    return std::unique_ptr<EncodedGeography>(
+      new EncodedGeography(start, geographySize, decoded.get())
+    );
+  }
+
+  Geography::Type GeographyType() {
+    return this->type;
+  }
+
+  std::unique_ptr<Geography> DecodedCopy() {
+    Decoder decoder(this->data, this->size);
+    std::unique_ptr<Geography> decoded = GeographyEncoder::DecodeGeography(&decoder);
+    if (!decoded) {
+      // checked by Create()
+      throw std::runtime_error("Can't decode encoded geography");
+    }
+
+    return decoded;
+  }
+
+  bool FindValidationError(S2Error* error) {
+    return this->DecodedCopy()->FindValidationError(error);
+  }
+
+  bool IsCollection() {
+    return this->isCollection;
+  }
+
+  int Dimension() {
+    return this->dimension;
+  }
+
+  int NumPoints() {
+    return this->numPoints;
+  }
+
+  bool IsEmpty() {
+    return this->isEmpty;
+  }
+
+  double Area() {
+    return this->DecodedCopy()->Area();
+  }
+
+  double Length() {
+    return this->DecodedCopy()->Length();
+  }
+
+  double Perimeter() {
+    return this->DecodedCopy()->Perimeter();
+  }
+
+  double X() {
+    return this->DecodedCopy()->X();
+  }
+
+  double Y() {
+    return this->DecodedCopy()->Y();
+  }
+
+  S2Point Centroid() {
+    return this->DecodedCopy()->Centroid();
+  }
+
+  std::unique_ptr<Geography> Boundary() {
+    return this->DecodedCopy()->Boundary();
+  }
+
+  void Export(WKGeometryHandler* handler, uint32_t partId) {
+    this->DecodedCopy()->Export(handler, partId);
+  }
+
+  std::vector<int> BuildShapeIndex(MutableS2ShapeIndex* index) {
+    std::shared_ptr<const std::string> shapeData = this->encodeShapes();
+    Decoder decoder(shapeData->data(), shapeData->size());
+    s2shapeutil::TaggedShapeFactory shapeFactory = s2shapeutil::LazyDecodeShapeFactory(&decoder);
+
+    std::vector<int> shapeIds(shapeFactory.size());
+    for (int i = 0; i < shapeFactory.size(); i++) {
+      std::unique_ptr<S2Shape> shape = shapeFactory[i];
+      if (!shape) {
+        throw std::runtime_error("Can't decode shapes of encoded geography");
+      }
+
+      shapeIds[i] = index->Add(absl::make_unique<SharedDataShape>(std::move(shape), shapeData));
+    }
+
+    this->shapeBytes.store(shapeData->size(), std::memory_order_relaxed);
+    return shapeIds;
+  }
+
+  // the encoded bytes (which may be shared with an R object)
+  size_t VertexSpaceUsed() {
+    return this->size;
+  }
+
+  // the shape encodings built for the most recent index
+  size_t ShapeSpaceUsed() {
+    return this->shapeBytes.load(std::memory_order_relaxed);
+  }
+
+private:
+  EncodedGeography(const char* data, size_t size, Geography* decoded):
+    data(data), size(size), type(decoded->GeographyType()),
+    isCollection(decoded->IsCollection()), dimension(decoded->Dimension()),
+    numPoints(decoded->NumPoints()), isEmpty(decoded->IsEmpty()), shapeBytes(0) {}
+
+  // The compact encoding of the lax versions of the feature's shapes (with
+  // the same edges, so the shape ids and edge ids of an index built from them
+  // are the same as if the feature were decoded)
+  std::shared_ptr<const std::string> encodeShapes() {
+    // the shapes refer to the decoded copy
+    std::unique_ptr<Geography> decoded = this->DecodedCopy();
+    MutableS2ShapeIndex shapes;
+    decoded->BuildShapeIndex(&shapes);
+
+    MutableS2ShapeIndex laxShapes;
+    for (int i = 0; i < shapes.num_shape_ids(); i++) {
+      laxShapes.Add(laxShape(*shapes.shape(i)));
+    }
+
+    Encoder encoder;
+    if (!s2shapeutil::CompactEncodeTaggedShapes(laxShapes, &encoder)) {
+      throw std::runtime_error("Can't encode shapes of encoded geography");
+    }
+
+    return std::make_shared<const std::string>(encoder.base(), encoder.length());
+  }
+
+  static std::unique_ptr<S2Shape> laxShape(const S2Shape& shape) {
+    switch (shape.dimension()) {
+    case 0: {
+      std::vector<S2Point> points(shape.num_edges());
+      for (int i = 0; i < shape.num_edges(); i++) {
+        points[i] = shape.edge(i).v0;
+      }
+
+      return absl::make_unique<S2PointVectorShape>(std::move(points));
+    }
+
+    case 1: {
+      // polyline shapes in a Geography have one chain
+      std::vector<S2Point> vertices;
+      if (shape.num_edges() > 0) {
+        for (int i = 0; i < shape.num_edges(); i++) {
+          vertices.push_back(shape.edge(i).v0);
+        }
+        vertices.push_back(shape.edge(shape.num_edges() - 1).v1);
+      }
+
+      return absl::make_unique<S2LaxPolylineShape>(vertices);
+    }
+
+    default: {
+      // a loop with no vertices is the full loop
+      std::vector<S2LaxPolygonShape::Loop> loops(shape.num_chains());
+      for (int i = 0; i < shape.num_chains(); i++) {
+        S2Shape::Chain chain = shape.chain(i);
+        for (int j = 0; j < chain.length; j++) {
+          loops[i].push_back(shape.chain_edge(i, j).v0);
+        }
+      }
+
+      return absl::make_unique<S2LaxPolygonShape>(loops);
+    }
+    }
+  }
+
+  // A lazily decoded shape that keeps the encoding it refers to alive (the
+  // index that owns the shape may outlive the next call to BuildShapeIndex())
+  class SharedDataShape: public S2Shape {
+  public:
+    SharedDataShape(std::unique_ptr<S2Shape> shape, std::shared_ptr<const std::string> data):
+      data(data), shape(std::move(shape)) {}
+    int num_edges() const { return this->shape->num_edges(); }
+    Edge edge(int edgeId) const { return this->shape->edge(edgeId); }
+    int dimension() const { return this->shape->dimension(); }
+    ReferencePoint GetReferencePoint() const { return this->shape->GetReferencePoint(); }
+    int num_chains() const { return this->shape->num_chains(); }
+    Chain chain(int chainId) const { return this->shape->chain(chainId); }
+    Edge chain_edge(int chainId, int offset) const { return this->shape->chain_edge(chainId, offset); }
+    ChainPosition chain_position(int edgeId) const { return this->shape->chain_position(edgeId); }
+
+  private:
+    std::shared_ptr<const std::string> data;
+    std::unique_ptr<S2Shape> shape;
+  };
+
+  const char* data;
+  size_t size;
+  Geography::Type type;
+  bool isCollection;
+  int dimension;
+  int numPoints;
+  bool isEmpty;
+  std::atomic<size_t> shapeBytes;
+};
+
+#endif
@@ -34,6 +34,10 @@ public:
     return this->features.size() > 0;
   }
 
+  const std::vector<std::unique_ptr<Geography>>& Features() {
+    return this->features;
+  }
+
   int Dimension() {
     int dimension = -1;
     for (size_t i = 0; i < this->features.size(); i++) {
@@ -121,6 +125,30 @@ public:
     return shapeIds;
   }
 
+  size_t VertexSpaceUsed() {
+    size_t size = this->features.capacity() * sizeof(std::unique_ptr<Geography>);
+    for (const auto& feature: this->features) {
+      size += sizeof(*feature) + feature->VertexSpaceUsed();
+    }
+    return size;
+  }
+
+  size_t InternalIndexSpaceUsed() {
+    size_t size = 0;
+    for (const auto& feature: this->features) {
+      size += feature->InternalIndexSpaceUsed() + feature->ShapeIndexSpaceUsed();
+    }
+    return size;
+  }
+
+  size_t ShapeSpaceUsed() {
+    size_t size = 0;
+    for (const auto& feature: this->features) {
+      size += feature->ShapeSpaceUsed();
+    }
+    return size;
+  }
+
   void Export(WKGeometryHandler* handler, uint32_t partId) {
     WKGeometryMeta meta(WKGeometryType::GeometryCollection, false, false, false);
     meta.hasSize = true;
@@ -5,6 +5,7 @@
 #include <stdexcept>
 
 #include "geography.h"
+#include "s2-profile.h"
 #include <Rcpp.h>
 
 class GeographyOperatorException: public std::runtime_error {
@@ -16,6 +17,7 @@ template<class VectorType, class ScalarType>
 class UnaryGeographyOperator {
 public:
   VectorType processVector(Rcpp::List geog) {
+    Profile::Timer timer(Profile::OPERATOR);
     VectorType output(geog.size());
 
     Rcpp::IntegerVector problemId;
@@ -29,7 +31,8 @@ public:
       if (item == R_NilValue) {
         output[i] = VectorType::get_na();
       } else {
-        Rcpp::XPtr<Geography> feature(item);
+        Rcpp::XPtr<Geography> feature(checkGeographyPointer(item));
+        Profile::Count(Profile::FEATURE);
 
         try {
           output[i] = this->processFeature(feature, i);
@@ -39,6 +42,9 @@ public:
           problems.push_back(e.what());
         }
       }
+
+      // indexes built for previous features are no longer in use
+      ShapeIndexBudget::Global().Enforce();
     }
 
     if (problemId.size() > 0) {
@@ -62,6 +68,8 @@ public:
       Rcpp::stop("Incompatible lengths");
     }
 
+    Profile::Timer timer(Profile::OPERATOR);
+
     VectorType output(geog1.size());
 
     Rcpp::IntegerVector problemId;
@@ -78,8 +86,9 @@ public:
       if (item1 ==  R_NilValue || item2 == R_NilValue) {
         output[i] = VectorType::get_na();
       } else {
-        Rcpp::XPtr<Geography> feature1(item1);
-        Rcpp::XPtr<Geography> feature2(item2);
+        Rcpp::XPtr<Geography> feature1(checkGeographyPointer(item1));
+        Rcpp::XPtr<Geography> feature2(checkGeographyPointer(item2));
+        Profile::Count(Profile::FEATURE);
 
         try {
           output[i] = processFeature(feature1, feature2, i);
@@ -89,6 +98,8 @@ public:
           problems.push_back(e.what());
         }
       }
+
+      ShapeIndexBudget::Global().Enforce();
     }
 
     if (problemId.size() > 0) {
@@ -0,0 +1,107 @@
+
+#ifndef GEOGRAPHY_RELATE_H
+#define GEOGRAPHY_RELATE_H
+
+#include "s2/s2boolean_operation.h"
+#include "geography.h"
+
+// Computes all of the binary predicates exposed by the package for a single
+// pair of features as a bitmask. S2 doesn't have a DE-9IM style relate
+// engine, so this shares work between predicates instead: disjoint pairs
+// exit after a single Intersects() call, containment is only checked
+// for pairs that intersect, and equality is only checked for pairs that
+// cover each other in both directions.
+class GeographyRelation {
+public:
+  enum Relation {
+    INTERSECTS = 1,
+    TOUCHES = 2,
+    COVERS = 4,
+    COVERED_BY = 8,
+    CONTAINS = 16,
+    WITHIN = 32,
+    EQUALS = 64
+  };
+
+  // options should be the user-specified options; each predicate
+  // uses the same polygon/polyline model that its pairwise version
+  // uses by default (open for contains/within, closed for covers/covered_by)
+  GeographyRelation(S2BooleanOperation::Options options): options(options) {
+    this->closedOptions = options;
+    this->closedOptions.set_polygon_model(S2BooleanOperation::PolygonModel::CLOSED);
+    this->closedOptions.set_polyline_model(S2BooleanOperation::PolylineModel::CLOSED);
+
+    this->openOptions = options;
+    this->openOptions.set_polygon_model(S2BooleanOperation::PolygonModel::OPEN);
+    this->openOptions.set_polyline_model(S2BooleanOperation::PolylineModel::OPEN);
+  }
+
+  int relate(Geography* feature1, Geography* feature2) {
+    return this->relate(
+      feature1->ShapeIndex(), feature2->ShapeIndex(),
+      feature1->IsEmpty(), feature2->IsEmpty()
+    );
+  }
+
+  int relate(S2ShapeIndex* index1, S2ShapeIndex* index2, bool empty1, bool empty2) {
+    // two empty features are equal but nothing else
+    if (empty1 && empty2) {
+      return EQUALS;
+    }
+
+    // the closed model is the most permissive: if the features don't
+    // intersect here, no other relation is possible
+    if (!S2BooleanOperation::Intersects(*index1, *index2, this->closedOptions)) {
+      return 0;
+    }
+
+    int result = 0;
+    bool openIntersects = S2BooleanOperation::Intersects(*index1, *index2, this->openOptions);
+
+    // the open model is the least permissive, so the user-specified model
+    // only needs to be checked if the interiors don't intersect
+    if (openIntersects ||
+        S2BooleanOperation::Intersects(*index1, *index2, this->options)) {
+      result |= INTERSECTS;
+    }
+
+    if (!openIntersects) {
+      result |= TOUCHES;
+    }
+
+    // Contains(x, EMPTY) is true in S2 but not in BigQuery or GEOS
+    bool covers = !empty2 && S2BooleanOperation::Contains(*index1, *index2, this->closedOptions);
+    bool coveredBy = !empty1 && S2BooleanOperation::Contains(*index2, *index1, this->closedOptions);
+
+    if (covers) {
+      result |= COVERS;
+    }
+
+    if (coveredBy) {
+      result |= COVERED_BY;
+    }
+
+    // containment in the open model implies containment in the closed model
+    if (covers && S2BooleanOperation::Contains(*index1, *index2, this->openOptions)) {
+      result |= CONTAINS;
+    }
+
+    if (coveredBy && S2BooleanOperation::Contains(*index2, *index1, this->openOptions)) {
+      result |= WITHIN;
+    }
+
+    if (covers && coveredBy &&
+        S2BooleanOperation::Equals(*index1, *index2, this->options)) {
+      result |= EQUALS;
+    }
+
+    return result;
+  }
+
+private:
+  S2BooleanOperation::Options options;
+  S2BooleanOperation::Options closedOptions;
+  S2BooleanOperation::Options openOptions;
+};
+
+#endif
@@ -2,7 +2,13 @@
 #ifndef GEOGRAPHY_H
 #define GEOGRAPHY_H
 
+#include <algorithm>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 #include "s2/s2latlng.h"
 #include "s2/s2polyline.h"
 #include "s2/s2polygon.h"
@@ -11,9 +17,82 @@
 #include "s2/mutable_s2shape_index.h"
 #include "s2/s2point_vector_shape.h"
 #include "s2/s2cap.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2region_coverer.h"
+#include "s2/s2shapeutil_coding.h"
+#include "s2/util/coding/coder.h"
 #include "wk/geometry-handler.hpp"
+#include "s2-profile.h"
 #include <Rcpp.h>
 
+class Geography;
+
+// Keeps track of the shape indexes that were built lazily by
+// Geography::ShapeIndex() so that the least recently used ones can be
+// released when together they use more memory than a budget. Indexes that
+// were built explicitly (e.g., by s2_prepare()) are never released.
+class ShapeIndexBudget {
+public:
+  ShapeIndexBudget(): budget(0), totalBytes(0), lastTotalBytes(0), tick(1) {}
+
+  static ShapeIndexBudget& Global() {
+    static ShapeIndexBudget global;
+    return global;
+  }
+
+  // the budget in bytes (zero if indexes are never released)
+  size_t Budget() const {
+    return this->budget.load(std::memory_order_relaxed);
+  }
+
+  void SetBudget(size_t budget) {
+    this->budget.store(budget, std::memory_order_relaxed);
+    this->lastTotalBytes.store(0, std::memory_order_relaxed);
+  }
+
+  size_t TotalBytes() const {
+    return this->totalBytes.load(std::memory_order_relaxed);
+  }
+
+  // incremented by Enforce() so that indexes can record when they were
+  // last used
+  uint64_t Tick() const {
+    return this->tick.load(std::memory_order_relaxed);
+  }
+
+  void Add(Geography* geog, size_t bytes) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->indexes[geog] = bytes;
+    this->totalBytes.fetch_add(bytes, std::memory_order_relaxed);
+  }
+
+  void Remove(Geography* geog) {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    auto it = this->indexes.find(geog);
+    if (it != this->indexes.end()) {
+      this->totalBytes.fetch_sub(it->second, std::memory_order_relaxed);
+      this->indexes.erase(it);
+    }
+  }
+
+  // Releases the least recently used indexes until the total is within the
+  // budget. Unless keepRecent is false, indexes used since the last call
+  // are kept because they may still be in use by the caller, and indexes
+  // aren't scanned again until the total changes if a scan couldn't bring
+  // the total within the budget (e.g., because all indexes are in use by a
+  // matrix operator). This must not be called while other threads may be
+  // using an index.
+  inline void Enforce(bool keepRecent = true);
+
+private:
+  std::atomic<size_t> budget;
+  std::atomic<size_t> totalBytes;
+  std::atomic<size_t> lastTotalBytes;
+  std::atomic<uint64_t> tick;
+  std::mutex mutex;
+  std::unordered_map<Geography*, size_t> indexes;
+};
+
 class Geography {
 public:
 
@@ -25,7 +104,7 @@ public:
     GEOGRAPHY_COLLECTION
   };
 
-  Geography(): hasIndex(false) {}
+  Geography(): hasIndex(false), isBudgeted(false), lastUsed(0) {}
 
   // accessors need to be methods, since their calculation
   // depends on the geometry type
@@ -61,7 +140,11 @@ public:
   // but exporting can be done here
   virtual void Export(WKGeometryHandler* handler, uint32_t partId) = 0;
 
-  virtual ~Geography() {}
+  virtual ~Geography() {
+    if (this->isBudgeted) {
+      ShapeIndexBudget::Global().Remove(this);
+    }
+  }
 
   // Most calculations will use the ShapeIndex, but sometimes access to the
   // underlying point, line, or polygon is useful to keep this class from
@@ -78,21 +161,206 @@ public:
     return nullptr;
   }
 
-  // other calculations use ShapeIndex
+  // Geographies that don't keep decoded S2 objects (e.g., EncodedGeography)
+  // return nullptr from Point(), Polyline(), and Polygon() and a decoded
+  // copy of themselves from DecodedCopy(); others return nullptr.
+  virtual std::unique_ptr<Geography> DecodedCopy() {
+    return nullptr;
+  }
+
+  // other calculations use ShapeIndex. The index is built (including
+  // its cells, which MutableS2ShapeIndex would otherwise build on the first
+  // query) the first time it is needed, which may happen on more than one
+  // thread at once.
   virtual S2ShapeIndex* ShapeIndex() {
-    if (!this->hasIndex) {
-      this->BuildShapeIndex(&this->shape_index_);
-      this->hasIndex = true;
+    ShapeIndexBudget& budget = ShapeIndexBudget::Global();
+    uint64_t tick = budget.Tick();
+    if (this->lastUsed.load(std::memory_order_relaxed) != tick) {
+      this->lastUsed.store(tick, std::memory_order_relaxed);
+    }
+
+    if (!this->hasIndex.load(std::memory_order_acquire)) {
+      std::lock_guard<std::mutex> lock(this->indexMutex);
+      if (!this->hasIndex.load(std::memory_order_relaxed)) {
+        Profile::Timer timer(Profile::INDEX_BUILD);
+        this->BuildShapeIndex(&this->shape_index_);
+        this->shape_index_.ForceBuild();
+        budget.Add(this, this->shapeIndexSpaceUsed());
+        this->isBudgeted = true;
+        this->hasIndex.store(true, std::memory_order_release);
+      }
     }
 
     return &this->shape_index_;
   }
 
+  uint64_t LastUsed() const {
+    return this->lastUsed.load(std::memory_order_relaxed);
+  }
+
+  // Releases an index built by ShapeIndex() (it will be rebuilt the next time
+  // it is needed). This must not be called while the index is in use.
+  void ReleaseShapeIndex() {
+    std::lock_guard<std::mutex> lock(this->indexMutex);
+    if (this->isBudgeted) {
+      ShapeIndexBudget::Global().Remove(this);
+      this->isBudgeted = false;
+      this->shape_index_.Clear();
+      this->hasIndex.store(false, std::memory_order_release);
+    }
+  }
+
+  // The approximate number of bytes used by the vertices (and the objects
+  // that hold them), by indexes internal to the underlying S2 objects (e.g.,
+  // the index of each S2Loop), and by ShapeIndex() (zero if it hasn't
+  // been built).
+  virtual size_t VertexSpaceUsed() = 0;
+
+  virtual size_t InternalIndexSpaceUsed() {
+    return 0;
+  }
+
+  // shapes are owned by the index but some of them copy the vertices
+  virtual size_t ShapeSpaceUsed() {
+    return 0;
+  }
+
+  size_t ShapeIndexSpaceUsed() {
+    std::lock_guard<std::mutex> lock(this->indexMutex);
+    if (!this->hasIndex.load(std::memory_order_relaxed)) {
+      return 0;
+    }
+
+    return this->shapeIndexSpaceUsed();
+  }
+
+  // The approximate number of bytes used by the covering cached by
+  // Covering() (zero if none was cached). Cached coverings are kept until
+  // they are replaced and aren't counted by ShapeIndexBudget, because
+  // releasing them would change the candidates found by joins.
+  size_t CoveringSpaceUsed() {
+    std::lock_guard<std::mutex> lock(this->coveringMutex);
+    if (!this->cachedCovering) {
+      return 0;
+    }
+
+    return sizeof(S2CellUnion) + this->cachedCovering->num_cells() * sizeof(S2CellId);
+  }
+
+  // Builds the index with maxEdgesPerCell (rebuilding it if it was built
+  // with a different value) and applies all pending updates so that the
+  // first query doesn't have to. This must not be called while the index
+  // is being used by another thread.
+  void PrepareShapeIndex(int maxEdgesPerCell) {
+    std::lock_guard<std::mutex> lock(this->indexMutex);
+    Profile::Timer timer(Profile::INDEX_BUILD);
+
+    this->unbudget();
+
+    if (this->hasIndex.load(std::memory_order_relaxed) &&
+        this->shape_index_.options().max_edges_per_cell() != maxEdgesPerCell) {
+      this->shape_index_.Clear();
+      this->hasIndex.store(false, std::memory_order_relaxed);
+    }
+
+    if (!this->hasIndex.load(std::memory_order_relaxed)) {
+      MutableS2ShapeIndex::Options options;
+      options.set_max_edges_per_cell(maxEdgesPerCell);
+      this->shape_index_.Init(options);
+      this->BuildShapeIndex(&this->shape_index_);
+    }
+
+    this->shape_index_.ForceBuild();
+    this->hasIndex.store(true, std::memory_order_release);
+  }
+
+  // Appends the cell structure of the (fully built) index to encoder.
+  // The shapes themselves are not encoded, since they can be recreated
+  // from the geography using BuildShapeIndex().
+  void EncodeShapeIndex(Encoder* encoder) {
+    this->ShapeIndex();
+    this->shape_index_.ForceBuild();
+    this->shape_index_.Encode(encoder);
+  }
+
+  // Initializes the index from the output of EncodeShapeIndex() without
+  // rebuilding it. Returns false if the index could not be decoded.
+  bool DecodeShapeIndex(Decoder* decoder) {
+    MutableS2ShapeIndex shapes;
+    this->BuildShapeIndex(&shapes);
+    s2shapeutil::VectorShapeFactory shapeFactory(shapes.ReleaseAll());
+
+    std::lock_guard<std::mutex> lock(this->indexMutex);
+    this->unbudget();
+    if (!this->shape_index_.Init(decoder, shapeFactory)) {
+      return false;
+    }
+
+    this->hasIndex.store(true, std::memory_order_release);
+    return true;
+  }
+
   virtual S2ShapeIndexRegion<S2ShapeIndex> ShapeIndexRegion() {
 	  S2ShapeIndex *ix = this->ShapeIndex();
 	  return MakeS2ShapeIndexRegion(ix);
   }
 
+  // Returns a covering of the feature (or an interior covering if
+  // interior is true). A covering can be cached with the feature
+  // (replacing any covering cached previously) so that it is returned
+  // without recomputing it when the same options are requested again.
+  S2CellUnion Covering(const S2RegionCoverer::Options& options, bool interior, bool cache) {
+    {
+      std::lock_guard<std::mutex> lock(this->coveringMutex);
+      if (this->cachedCovering && this->cachedCoveringInterior == interior &&
+          sameCoveringOptions(this->cachedCoveringOptions, options)) {
+        return *this->cachedCovering;
+      }
+    }
+
+    S2RegionCoverer coverer(options);
+    S2ShapeIndexRegion<S2ShapeIndex> region = this->ShapeIndexRegion();
+    S2CellUnion covering;
+    if (interior) {
+      covering = coverer.GetInteriorCovering(region);
+    } else {
+      covering = coverer.GetCovering(region);
+    }
+
+    if (cache) {
+      std::lock_guard<std::mutex> lock(this->coveringMutex);
+      this->cachedCovering = std::make_shared<const S2CellUnion>(covering);
+      this->cachedCoveringOptions = options;
+      this->cachedCoveringInterior = interior;
+    }
+
+    return covering;
+  }
+
+  // The covering cached by Covering(), or nullptr if no (exterior) covering
+  // was cached. Any covering contains the feature, so joins use this
+  // instead of computing their own covering when it is available.
+  std::shared_ptr<const S2CellUnion> CachedCovering() {
+    std::lock_guard<std::mutex> lock(this->coveringMutex);
+    if (this->cachedCoveringInterior) {
+      return nullptr;
+    }
+
+    return this->cachedCovering;
+  }
+
+  // The covering cached by Covering() if it is an (exterior) covering
+  // computed with options, or nullptr otherwise
+  std::shared_ptr<const S2CellUnion> CachedCovering(const S2RegionCoverer::Options& options) {
+    std::lock_guard<std::mutex> lock(this->coveringMutex);
+    if (this->cachedCoveringInterior || !this->cachedCovering ||
+        !sameCoveringOptions(this->cachedCoveringOptions, options)) {
+      return nullptr;
+    }
+
+    return this->cachedCovering;
+  }
+
   virtual S2Cap GetCapBound() {
 	  return this->ShapeIndexRegion().GetCapBound();
   }
@@ -103,9 +371,102 @@ public:
 
 protected:
   MutableS2ShapeIndex shape_index_;
-  bool hasIndex;
+  std::atomic<bool> hasIndex;
+  std::mutex indexMutex;
+  // guarded by indexMutex
+  bool isBudgeted;
+  std::atomic<uint64_t> lastUsed;
+
+private:
+  std::mutex coveringMutex;
+  // guarded by coveringMutex
+  std::shared_ptr<const S2CellUnion> cachedCovering;
+  S2RegionCoverer::Options cachedCoveringOptions;
+  bool cachedCoveringInterior = false;
+
+  static bool sameCoveringOptions(const S2RegionCoverer::Options& options1,
+                                  const S2RegionCoverer::Options& options2) {
+    return options1.min_level() == options2.min_level() &&
+      options1.max_level() == options2.max_level() &&
+      options1.level_mod() == options2.level_mod() &&
+      options1.max_cells() == options2.max_cells();
+  }
+
+  size_t shapeIndexSpaceUsed() {
+    return this->shape_index_.SpaceUsed() + this->ShapeSpaceUsed();
+  }
+
+  // called with indexMutex held when the index is built explicitly
+  void unbudget() {
+    if (this->isBudgeted) {
+      ShapeIndexBudget::Global().Remove(this);
+      this->isBudgeted = false;
+    }
+  }
 };
 
+void ShapeIndexBudget::Enforce(bool keepRecent) {
+  uint64_t current = this->tick.fetch_add(1, std::memory_order_relaxed);
+  if (!keepRecent) {
+    current++;
+  }
+
+  size_t budget = this->Budget();
+  size_t totalBytes = this->TotalBytes();
+  if (budget == 0 || totalBytes <= budget) {
+    return;
+  }
+
+  if (keepRecent && totalBytes == this->lastTotalBytes.load(std::memory_order_relaxed)) {
+    return;
+  }
+
+  std::vector<std::pair<uint64_t, Geography*>> candidates;
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    for (const auto& item: this->indexes) {
+      uint64_t lastUsed = item.first->LastUsed();
+      if (lastUsed < current) {
+        candidates.push_back(std::make_pair(lastUsed, item.first));
+      }
+    }
+  }
+
+  std::sort(candidates.begin(), candidates.end());
+  for (const auto& candidate: candidates) {
+    if (this->TotalBytes() <= budget) {
+      break;
+    }
+
+    candidate.second->ReleaseShapeIndex();
+  }
+
+  this->lastTotalBytes.store(this->TotalBytes(), std::memory_order_relaxed);
+}
+
+
+// A feature whose Point(), Polyline(), and Polygon() can be used: the feature
+// itself or, if it doesn't keep decoded S2 objects, a decoded copy that is
+// released when this goes out of scope (unless decode is false, e.g., when
+// the decoded copy is only needed for some types of feature).
+class DecodedGeography {
+public:
+  DecodedGeography(Geography* feature, bool decode = true):
+    copy(decode ? feature->DecodedCopy() : nullptr),
+    feature(copy ? copy.get() : feature) {}
+
+  Geography* operator->() const {
+    return this->feature;
+  }
+
+  Geography* get() const {
+    return this->feature;
+  }
+
+private:
+  std::unique_ptr<Geography> copy;
+  Geography* feature;
+};
 
 class GeographyBuilder: public WKGeometryHandler {
 public:
@@ -113,4 +474,20 @@ public:
   virtual ~GeographyBuilder() {}
 };
 
+// Returns item (a non-NULL element of an s2_geography vector) after checking
+// that its external pointer is still valid. Pointers aren't valid after an
+// s2_geography vector is saved and reloaded or sent to another R process,
+// and code that calls XPtr::get() would otherwise treat the feature as
+// missing.
+inline SEXP checkGeographyPointer(SEXP item) {
+  if (R_ExternalPtrAddr(item) == nullptr) {
+    Rcpp::stop(
+      "external pointer is not valid: s2_geography vectors can't be saved or "
+      "sent to other R processes (use s2_geog_serialize() instead)"
+    );
+  }
+
+  return item;
+}
+
 #endif
@@ -108,6 +108,14 @@ public:
     return shapeIds;
   }
 
+  size_t VertexSpaceUsed() {
+    return this->points.capacity() * sizeof(S2Point);
+  }
+
+  size_t ShapeSpaceUsed() {
+    return this->points.size() * sizeof(S2Point);
+  }
+
   void Export(WKGeometryHandler* handler, uint32_t partId) {
     S2LatLng point;
 
@@ -105,6 +105,19 @@ public:
     return shapeIds;
   }
 
+  size_t VertexSpaceUsed() {
+    size_t size = sizeof(S2Polygon);
+    for (int i = 0; i < this->polygon->num_loops(); i++) {
+      size += sizeof(S2Loop) + this->polygon->loop(i)->num_vertices() * sizeof(S2Point);
+    }
+    return size;
+  }
+
+  // S2Polygon::SpaceUsed() includes the index of the polygon and of each loop
+  size_t InternalIndexSpaceUsed() {
+    return this->polygon->SpaceUsed() - this->VertexSpaceUsed();
+  }
+
   void Export(WKGeometryHandler* handler, uint32_t partId) {
     std::vector<std::vector<int>> flatIndices = this->flatLoopIndices();
 
@@ -128,6 +128,14 @@ public:
     return shapeIds;
   }
 
+  size_t VertexSpaceUsed() {
+    size_t size = this->polylines.capacity() * sizeof(std::unique_ptr<S2Polyline>);
+    for (const auto& polyline: this->polylines) {
+      size += polyline->SpaceUsed();
+    }
+    return size;
+  }
+
   void Export(WKGeometryHandler* handler, uint32_t partId) {
     S2LatLng point;
 
@@ -1,5 +1,6 @@
 
 #include "geography-operator.h"
+#include "s2-point-distance.h"
 #include "s2/s2closest_edge_query.h"
 #include "s2/s2furthest_edge_query.h"
 #include <Rcpp.h>
@@ -161,10 +162,12 @@ NumericVector cpp_s2_project_normalized(List geog1, List geog2) {
 
       if (feature1->GeographyType() == Geography::Type::GEOGRAPHY_POLYLINE) {
         if (feature2->GeographyType() == Geography::Type::GEOGRAPHY_POINT) {
-          S2Point point = feature2->Point()->at(0);
+          DecodedGeography polyline(feature1.get());
+          DecodedGeography point(feature2.get());
+          S2Point point2 = point->Point()->at(0);
           int next_vertex;
-          S2Point point_on_line = feature1->Polyline()->at(0)->Project(point, &next_vertex);
-          return feature1->Polyline()->at(0)->UnInterpolate(point_on_line, next_vertex);
+          S2Point point_on_line = polyline->Polyline()->at(0)->Project(point2, &next_vertex);
+          return polyline->Polyline()->at(0)->UnInterpolate(point_on_line, next_vertex);
         } else {
           throw GeographyOperatorException("`y` must be a point geography");
         }
@@ -180,13 +183,28 @@ NumericVector cpp_s2_project_normalized(List geog1, List geog2) {
 }
 
 // [[Rcpp::export]]
-NumericVector cpp_s2_distance(List geog1, List geog2) {
+NumericVector cpp_s2_distance(List geog1, List geog2, double maxError) {
+  PointDistanceKernel kernel;
+  if (kernel.init(geog1, geog2)) {
+    return kernel.distance();
+  }
+
   class Op: public BinaryGeographyOperator<NumericVector, double> {
+  public:
+    S1ChordAngle maxError;
+    Op(double maxError): maxError(S1ChordAngle::Radians(maxError)) {}
 
     double processFeature(XPtr<Geography> feature1,
                           XPtr<Geography> feature2,
                           R_xlen_t i) {
+      if (isSinglePoint(feature1.get()) && isSinglePoint(feature2.get())) {
+        return singlePointDistance(feature1.get(), feature2.get()).ToAngle().radians();
+      }
+
       S2ClosestEdgeQuery query(feature1->ShapeIndex());
+      // a non-zero max_error lets the query stop as soon as it finds an
+      // edge within max_error of the true minimum distance
+      query.mutable_options()->set_max_error(this->maxError);
       S2ClosestEdgeQuery::ShapeIndexTarget target(feature2->ShapeIndex());
 
       const auto& result = query.FindClosestEdge(&target);
@@ -202,18 +220,32 @@ NumericVector cpp_s2_distance(List geog1, List geog2) {
     }
   };
 
-  Op op;
+  Op op(maxError);
   return op.processVector(geog1, geog2);
 }
 
 // [[Rcpp::export]]
-NumericVector cpp_s2_max_distance(List geog1, List geog2) {
+NumericVector cpp_s2_max_distance(List geog1, List geog2, double maxError) {
+  // for single points, the minimum and maximum distance are the same
+  PointDistanceKernel kernel;
+  if (kernel.init(geog1, geog2)) {
+    return kernel.distance();
+  }
+
   class Op: public BinaryGeographyOperator<NumericVector, double> {
+  public:
+    S1ChordAngle maxError;
+    Op(double maxError): maxError(S1ChordAngle::Radians(maxError)) {}
 
     double processFeature(XPtr<Geography> feature1,
                           XPtr<Geography> feature2,
                           R_xlen_t i) {
+      if (isSinglePoint(feature1.get()) && isSinglePoint(feature2.get())) {
+        return singlePointDistance(feature1.get(), feature2.get()).ToAngle().radians();
+      }
+
       S2FurthestEdgeQuery query(feature1->ShapeIndex());
+      query.mutable_options()->set_max_error(this->maxError);
       S2FurthestEdgeQuery::ShapeIndexTarget target(feature2->ShapeIndex());
 
       const auto& result = query.FindFurthestEdge(&target);
@@ -232,6 +264,6 @@ NumericVector cpp_s2_max_distance(List geog1, List geog2) {
     }
   };
 
-  Op op;
+  Op op(maxError);
   return op.processVector(geog1, geog2);
 }
@@ -1,6 +1,7 @@
 
 #include "s2/s2latlng_rect.h"
 #include "s2/s2cap.h"
+#include "s2/s2region_coverer.h"
 
 #include "s2-options.h"
 #include "geography-operator.h"
@@ -8,6 +9,8 @@
 #include "polyline-geography.h"
 #include "polygon-geography.h"
 #include "geography-collection.h"
+#include "s2-cell-union.h"
+#include "s2-parallel.h"
 
 #include <Rcpp.h>
 using namespace Rcpp;
@@ -23,7 +26,7 @@ DataFrame cpp_s2_bounds_cap(List geog) {
     if (item == R_NilValue) {
       lat[i] = lng[i] = angle[i] = NA_REAL;
     } else {
-      Rcpp::XPtr<Geography> feature(item);
+      Rcpp::XPtr<Geography> feature(checkGeographyPointer(item));
       S2Cap cap = feature->GetCapBound();
       S2LatLng center(cap.center());
       lng[i] = center.lng().degrees();
@@ -50,7 +53,7 @@ DataFrame cpp_s2_bounds_rect(List geog) {
     if (item == R_NilValue) {
       lng_lo[i] = lat_lo[i] = lng_hi[i] = lat_hi[i] = NA_REAL;
     } else {
-      Rcpp::XPtr<Geography> feature(item);
+      Rcpp::XPtr<Geography> feature(checkGeographyPointer(item));
       S2LatLngRect rect = feature->GetRectBound();
       lng_lo[i] = rect.lng_lo().degrees();
       lat_lo[i] = rect.lat_lo().degrees();
@@ -66,3 +69,33 @@ DataFrame cpp_s2_bounds_rect(List geog) {
     _["lat_hi"] = lat_hi
   );
 }
+
+// [[Rcpp::export]]
+List cpp_s2_covering(List geog, int minLevel, int maxLevel, int maxCells,
+                     bool interior, bool cache, int numThreads) {
+  S2RegionCoverer::Options options;
+  options.set_min_level(minLevel);
+  options.set_max_level(maxLevel);
+  options.set_max_cells(maxCells);
+
+  // coverings are computed in parallel but can only be converted to
+  // R objects on the main thread
+  std::vector<Geography*> features = geographyPointers(geog);
+  std::vector<S2CellUnion> coverings(features.size());
+  parallelFor(features.size(), [&](R_xlen_t i) {
+    if (features[i] != nullptr) {
+      coverings[i] = features[i]->Covering(options, interior, cache);
+    }
+  }, numThreads, 1);
+
+  List output(features.size());
+  for (R_xlen_t i = 0; i < output.size(); i++) {
+    if (features[i] == nullptr) {
+      output[i] = R_NilValue;
+    } else {
+      output[i] = cellUnionToItem(coverings[i]);
+    }
+  }
+
+  return output;
+}
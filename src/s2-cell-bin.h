@@ -0,0 +1,119 @@
+
+#ifndef S2_CELL_BIN_H
+#define S2_CELL_BIN_H
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// Accumulates a count and a sum of weights for each cell id in an open
+// addressing hash table (linear probing), which avoids sorting or copying
+// the points being binned. Id 0 (an invalid cell that is never the result
+// of converting a point to a cell) marks empty slots. Tables for chunks of
+// the input can be filled in parallel and merged in chunk order, so that
+// sums don't depend on the number of threads.
+class CellBinTable {
+public:
+  CellBinTable(): numEntries(0) {
+    this->resize(64);
+  }
+
+  int64_t size() const {
+    return this->numEntries;
+  }
+
+  void clear() {
+    std::fill(this->keys.begin(), this->keys.end(), 0);
+    std::fill(this->counts.begin(), this->counts.end(), 0);
+    std::fill(this->sums.begin(), this->sums.end(), 0);
+    this->numEntries = 0;
+  }
+
+  void add(uint64_t id, int64_t count, double sum) {
+    size_t slot = this->findSlot(id);
+    if (this->keys[slot] == 0) {
+      this->keys[slot] = id;
+      this->numEntries++;
+    }
+
+    this->counts[slot] += count;
+    this->sums[slot] += sum;
+
+    // keep the load factor below 1/2
+    if (this->numEntries * 2 > static_cast<int64_t>(this->keys.size())) {
+      this->resize(this->keys.size() * 2);
+    }
+  }
+
+  void merge(const CellBinTable& other) {
+    for (size_t slot = 0; slot < other.keys.size(); slot++) {
+      if (other.keys[slot] != 0) {
+        this->add(other.keys[slot], other.counts[slot], other.sums[slot]);
+      }
+    }
+  }
+
+  // Calls fn(id, count, sum) for each cell in increasing order of cell id
+  template <class Function>
+  void forEachSorted(Function fn) const {
+    std::vector<size_t> slots;
+    slots.reserve(this->numEntries);
+    for (size_t slot = 0; slot < this->keys.size(); slot++) {
+      if (this->keys[slot] != 0) {
+        slots.push_back(slot);
+      }
+    }
+
+    std::sort(slots.begin(), slots.end(), [this](size_t a, size_t b) {
+      return this->keys[a] < this->keys[b];
+    });
+
+    for (size_t slot: slots) {
+      fn(this->keys[slot], this->counts[slot], this->sums[slot]);
+    }
+  }
+
+private:
+  std::vector<uint64_t> keys;
+  std::vector<int64_t> counts;
+  std::vector<double> sums;
+  int64_t numEntries;
+  int shift;
+
+  size_t findSlot(uint64_t id) const {
+    // Fibonacci hashing mixes the high bits of cell ids (the low bits of
+    // cells at the same level are all the same)
+    size_t mask = this->keys.size() - 1;
+    size_t slot = (id * 0x9E3779B97F4A7C15ULL) >> this->shift;
+    while (this->keys[slot] != 0 && this->keys[slot] != id) {
+      slot = (slot + 1) & mask;
+    }
+
+    return slot;
+  }
+
+  void resize(size_t capacity) {
+    std::vector<uint64_t> oldKeys(capacity, 0);
+    std::vector<int64_t> oldCounts(capacity, 0);
+    std::vector<double> oldSums(capacity, 0);
+    oldKeys.swap(this->keys);
+    oldCounts.swap(this->counts);
+    oldSums.swap(this->sums);
+
+    this->shift = 64;
+    for (size_t i = capacity; i > 1; i >>= 1) {
+      this->shift--;
+    }
+
+    for (size_t slot = 0; slot < oldKeys.size(); slot++) {
+      if (oldKeys[slot] != 0) {
+        size_t newSlot = this->findSlot(oldKeys[slot]);
+        this->keys[newSlot] = oldKeys[slot];
+        this->counts[newSlot] = oldCounts[slot];
+        this->sums[newSlot] = oldSums[slot];
+      }
+    }
+  }
+};
+
+#endif
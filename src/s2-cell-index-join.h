@@ -0,0 +1,104 @@
+
+#ifndef S2_CELL_INDEX_JOIN_H
+#define S2_CELL_INDEX_JOIN_H
+
+#include <algorithm>
+#include <vector>
+
+#include "s2/s2cell_index.h"
+
+// Positions it at the non-empty range containing target (or the first
+// non-empty range after target if there isn't one)
+inline void seekCellIndexRange(S2CellIndex::NonEmptyRangeIterator* it, S2CellId target) {
+  it->Seek(target);
+  if (it->start_id() > target && it->Prev() && it->limit_id() <= target) {
+    it->Next();
+  }
+}
+
+inline void cellIndexRangeLabels(S2CellIndex::ContentsIterator* contents,
+                                 const S2CellIndex::RangeIterator& range,
+                                 std::vector<S2CellIndex::Label>* labels) {
+  labels->clear();
+  // without Clear(), labels seen in the previous range would be skipped
+  contents->Clear();
+  for (contents->StartUnion(range); !contents->done(); contents->Next()) {
+    labels->push_back(contents->label());
+  }
+}
+
+// Finds the pairs of labels whose cells intersect in two built
+// S2CellIndexes. Both indexes are stored as sorted, non-overlapping leaf cell
+// ranges, so this walks the ranges of both indexes in order (seeking past
+// ranges that don't overlap a range in the other index) like a sort-merge
+// join, and every label in a range of index1 is paired with every label in
+// an overlapping range of index2. candidates must have one element for each
+// label in index1, to which the intersecting labels in index2 are added
+// (sorted and without duplicates).
+inline void joinCellIndexes(const S2CellIndex& index1, const S2CellIndex& index2,
+                            std::vector<std::vector<S2CellIndex::Label>>* candidates) {
+  S2CellIndex::NonEmptyRangeIterator range1(&index1);
+  S2CellIndex::NonEmptyRangeIterator range2(&index2);
+  S2CellIndex::ContentsIterator contents1(&index1);
+  S2CellIndex::ContentsIterator contents2(&index2);
+  std::vector<S2CellIndex::Label> labels1, labels2;
+  bool range1Changed = true;
+  bool range2Changed = true;
+
+  range1.Begin();
+  range2.Begin();
+  while (!range1.done() && !range2.done()) {
+    if (range1.limit_id() <= range2.start_id()) {
+      seekCellIndexRange(&range1, range2.start_id());
+      range1Changed = true;
+      continue;
+    } else if (range2.limit_id() <= range1.start_id()) {
+      seekCellIndexRange(&range2, range1.start_id());
+      range2Changed = true;
+      continue;
+    }
+
+    if (range1Changed) {
+      cellIndexRangeLabels(&contents1, range1, &labels1);
+      range1Changed = false;
+    }
+
+    if (range2Changed) {
+      cellIndexRangeLabels(&contents2, range2, &labels2);
+      range2Changed = false;
+    }
+
+    for (S2CellIndex::Label label1: labels1) {
+      std::vector<S2CellIndex::Label>& labelCandidates = (*candidates)[label1];
+      for (S2CellIndex::Label label2: labels2) {
+        // consecutive ranges often pair the same labels
+        if (labelCandidates.empty() || labelCandidates.back() != label2) {
+          labelCandidates.push_back(label2);
+        }
+      }
+    }
+
+    // advance whichever range ends first (or both)
+    S2CellId limit1 = range1.limit_id();
+    S2CellId limit2 = range2.limit_id();
+    if (limit1 <= limit2) {
+      range1.Next();
+      range1Changed = true;
+    }
+
+    if (limit2 <= limit1) {
+      range2.Next();
+      range2Changed = true;
+    }
+  }
+
+  for (std::vector<S2CellIndex::Label>& labelCandidates: *candidates) {
+    std::sort(labelCandidates.begin(), labelCandidates.end());
+    labelCandidates.erase(
+      std::unique(labelCandidates.begin(), labelCandidates.end()),
+      labelCandidates.end()
+    );
+  }
+}
+
+#endif
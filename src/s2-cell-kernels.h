@@ -0,0 +1,301 @@
+
+#ifndef S2_CELL_KERNELS_H
+#define S2_CELL_KERNELS_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+
+#include "s2/s2cell_id.h"
+#include "s2/s2coords.h"
+#include "s2/util/bits/bits.h"
+
+// Batch versions of the S2CellId methods used by the s2_cell vector
+// functions, operating directly on the uint64_t buffers behind s2_cell
+// vectors. Each element takes a few bit operations, so the kernels avoid
+// branches (invalid cells and NAs are handled by selecting between
+// results, which compilers turn into conditional moves or vector blends)
+// and are written as plain loops that can be vectorized and are limited by
+// memory bandwidth rather than by per-element dispatch.
+//
+// naInt is R's NA_INTEGER (or NA_LOGICAL) and naBits is the bit pattern
+// of R's NA_REAL (an NA s2_cell).
+
+// the lowest set bit, which determines the level of valid cells
+inline uint64_t cellLsb(uint64_t id) {
+  return id & (~id + 1);
+}
+
+// S2CellId::is_valid()
+inline bool cellIsValid(uint64_t id) {
+  return ((id >> S2CellId::kPosBits) < 6) & ((cellLsb(id) & 0x1555555555555555ULL) != 0);
+}
+
+// R_IsNA() for the double with these bits (an NaN whose lower word is 1954)
+inline bool cellIsNA(uint64_t id) {
+  return (((id >> 52) & 0x7ff) == 0x7ff) & (static_cast<uint32_t>(id) == 1954);
+}
+
+// S2CellId::level() for valid cells (bit 63 is set so that the
+// result is defined for id == 0)
+inline int cellLevel(uint64_t id) {
+  return S2CellId::kMaxLevel - (Bits::FindLSBSetNonZero64(id | (1ULL << 63)) >> 1);
+}
+
+inline uint64_t cellRangeMin(uint64_t id) {
+  return id - (cellLsb(id) - 1);
+}
+
+inline uint64_t cellRangeMax(uint64_t id) {
+  return id + (cellLsb(id) - 1);
+}
+
+inline void cellIsNABatch(const uint64_t* x, int64_t n, int* out) {
+  for (int64_t i = 0; i < n; i++) {
+    out[i] = cellIsNA(x[i]);
+  }
+}
+
+inline void cellIsValidBatch(const uint64_t* x, int64_t n, int* out) {
+  for (int64_t i = 0; i < n; i++) {
+    out[i] = cellIsValid(x[i]);
+  }
+}
+
+inline void cellLevelBatch(const uint64_t* x, int64_t n, int* out, int naInt) {
+  for (int64_t i = 0; i < n; i++) {
+    out[i] = cellIsValid(x[i]) ? cellLevel(x[i]) : naInt;
+  }
+}
+
+inline void cellRangeMinBatch(const uint64_t* x, int64_t n, uint64_t* out, uint64_t naBits) {
+  for (int64_t i = 0; i < n; i++) {
+    out[i] = cellIsValid(x[i]) ? cellRangeMin(x[i]) : naBits;
+  }
+}
+
+inline void cellRangeMaxBatch(const uint64_t* x, int64_t n, uint64_t* out, uint64_t naBits) {
+  for (int64_t i = 0; i < n; i++) {
+    out[i] = cellIsValid(x[i]) ? cellRangeMax(x[i]) : naBits;
+  }
+}
+
+// S2CellId::parent(level), where a negative level is relative to the level
+// of the cell (e.g., -1 for the immediate parent). Levels that are
+// missing or finer than the cell's level result in NA.
+inline void cellParentBatch(const uint64_t* x, const int* level, int64_t n,
+                            uint64_t* out, uint64_t naBits) {
+  for (int64_t i = 0; i < n; i++) {
+    uint64_t id = x[i];
+    int cellLeveli = cellLevel(id);
+    int leveli = level[i] < 0 ? cellLeveli + level[i] : level[i];
+    bool ok = cellIsValid(id) & (leveli >= 0) & (leveli <= cellLeveli);
+
+    // clamp to keep the shift defined when the result isn't used
+    int shift = 2 * (S2CellId::kMaxLevel - std::min(std::max(leveli, 0), 30));
+    uint64_t newLsb = static_cast<uint64_t>(1) << shift;
+    uint64_t parent = (id & (~newLsb + 1)) | newLsb;
+    out[i] = ok ? parent : naBits;
+  }
+}
+
+// S2CellId(p).parent(level) for the points (x[i], y[i], z[i]), which need
+// not be unit length. The face and (u, v) coordinates are computed with
+// selects rather than the switch in S2::XYZtoFaceUV() so that this part of
+// the loop can be vectorized; the division and projection are the same
+// operations in the same order, so the results are identical.
+inline void cellFromXYZBatch(const double* x, const double* y, const double* z, int64_t n,
+                             int level, uint64_t* out) {
+  uint64_t lsb = static_cast<uint64_t>(1) << (2 * (S2CellId::kMaxLevel - level));
+  for (int64_t i = 0; i < n; i++) {
+    double ax = std::fabs(x[i]);
+    double ay = std::fabs(y[i]);
+    double az = std::fabs(z[i]);
+
+    // S2::GetFace(): the largest absolute component, + 3 if negative
+    int axis = (ax > ay) ? ((ax > az) ? 0 : 2) : ((ay > az) ? 1 : 2);
+    double a = (axis == 0) ? y[i] : -x[i];
+    double b = (axis == 2) ? -y[i] : z[i];
+    double d = (axis == 0) ? x[i] : ((axis == 1) ? y[i] : z[i]);
+    bool negative = d < 0;
+
+    // S2::ValidFaceXYZtoUV(), where u and v are swapped for faces 3-5
+    double u = (negative ? b : a) / d;
+    double v = (negative ? a : b) / d;
+
+    int face = axis + 3 * negative;
+    int i0 = S2::STtoIJ(S2::UVtoST(u));
+    int j0 = S2::STtoIJ(S2::UVtoST(v));
+    uint64_t id = S2CellId::FromFaceIJ(face, i0, j0).id();
+    out[i] = (id & (~lsb + 1)) | lsb;
+  }
+}
+
+// S2CellId(S2LatLng::FromDegrees(lat, lng).Normalized()).parent(level),
+// or naBits where lng or lat is NaN (including NA). Points are processed in
+// chunks so that the trigonometry (which dominates for leaf cells) runs in
+// one loop over arrays rather than interleaved with the cell id
+// computation.
+inline void cellFromLngLatBatch(const double* lng, const double* lat, int64_t n, int level,
+                                uint64_t* out, uint64_t naBits) {
+  const int64_t chunkSize = 256;
+  double x[chunkSize], y[chunkSize], z[chunkSize];
+
+  for (int64_t start = 0; start < n; start += chunkSize) {
+    int64_t chunkN = std::min(chunkSize, n - start);
+    const double* lngChunk = lng + start;
+    const double* latChunk = lat + start;
+
+    // S2LatLng::Normalized() and S2LatLng::ToPoint()
+    for (int64_t i = 0; i < chunkN; i++) {
+      double phi = std::max(-M_PI_2, std::min(M_PI_2, (M_PI / 180) * latChunk[i]));
+      double theta = std::remainder((M_PI / 180) * lngChunk[i], 2 * M_PI);
+      double cosphi = std::cos(phi);
+      x[i] = std::cos(theta) * cosphi;
+      y[i] = std::sin(theta) * cosphi;
+      z[i] = std::sin(phi);
+    }
+
+    cellFromXYZBatch(x, y, z, chunkN, level, out + start);
+
+    for (int64_t i = 0; i < chunkN; i++) {
+      bool na = std::isnan(lngChunk[i]) | std::isnan(latChunk[i]);
+      out[start + i] = na ? naBits : out[start + i];
+    }
+  }
+}
+
+// The value of each hex digit (either case), or 0x10 for other characters
+struct CellTokenDigits {
+  unsigned char values[256];
+
+  CellTokenDigits() {
+    std::fill(values, values + 256, 0x10);
+    for (int i = 0; i < 10; i++) {
+      values['0' + i] = i;
+    }
+
+    for (int i = 0; i < 6; i++) {
+      values['a' + i] = 10 + i;
+      values['A' + i] = 10 + i;
+    }
+  }
+};
+
+// S2CellId::FromToken(token, length).id() from the bytes of a token. A
+// lookup table is used rather than comparisons for each character, which
+// the compiler turns into hard-to-predict branches. Invalid tokens result
+// in 0 (S2CellId::None()).
+inline uint64_t cellFromToken(const char* token, size_t length) {
+  static const CellTokenDigits digits;
+
+  if (length == 0 || length > 16) {
+    return 0;
+  }
+
+  uint64_t id = 0;
+  unsigned char invalid = 0;
+  for (size_t i = 0; i < length; i++) {
+    unsigned char value = digits.values[static_cast<unsigned char>(token[i])];
+    invalid |= value;
+    id = (id << 4) | (value & 0xf);
+  }
+
+  // trailing zeros are omitted from tokens
+  id <<= 4 * (16 - length);
+  return (invalid & 0x10) ? 0 : id;
+}
+
+// S2CellId::ToToken() written to out (at least 16 bytes), returning the
+// number of characters written
+inline int cellToToken(uint64_t id, char* out) {
+  if (id == 0) {
+    out[0] = 'X';
+    return 1;
+  }
+
+  int numDigits = 16 - Bits::FindLSBSetNonZero64(id) / 4;
+  for (int i = 0; i < numDigits; i++) {
+    out[i] = "0123456789abcdef"[(id >> (60 - 4 * i)) & 0xf];
+  }
+
+  return numDigits;
+}
+
+// S2CellId::ToString() written to out (at least 32 bytes), returning the
+// number of characters written
+inline int cellToDebugString(uint64_t id, char* out) {
+  if (!cellIsValid(id)) {
+    const char* prefix = "Invalid: ";
+    std::copy(prefix, prefix + 9, out);
+    for (int i = 0; i < 16; i++) {
+      out[9 + i] = "0123456789abcdef"[(id >> (60 - 4 * i)) & 0xf];
+    }
+
+    return 25;
+  }
+
+  int level = cellLevel(id);
+  out[0] = '0' + static_cast<char>(id >> S2CellId::kPosBits);
+  out[1] = '/';
+  for (int i = 1; i <= level; i++) {
+    out[1 + i] = "0123"[(id >> (2 * (S2CellId::kMaxLevel - i) + 1)) & 3];
+  }
+
+  return 2 + level;
+}
+
+// Applies a binary kernel op(id1, id2) to x and y, either of which may be
+// of length 1 (n is the length of the output)
+template<class Op>
+inline void cellBinaryBatch(const uint64_t* x, bool recycleX, const uint64_t* y, bool recycleY,
+                            int64_t n, int* out, Op op) {
+  if (recycleX) {
+    uint64_t id1 = x[0];
+    for (int64_t i = 0; i < n; i++) {
+      out[i] = op(id1, y[i]);
+    }
+  } else if (recycleY) {
+    uint64_t id2 = y[0];
+    for (int64_t i = 0; i < n; i++) {
+      out[i] = op(x[i], id2);
+    }
+  } else {
+    for (int64_t i = 0; i < n; i++) {
+      out[i] = op(x[i], y[i]);
+    }
+  }
+}
+
+// S2CellId::contains()
+struct CellContainsKernel {
+  int naInt;
+  int operator()(uint64_t id1, uint64_t id2) const {
+    bool result = (id2 >= cellRangeMin(id1)) & (id2 <= cellRangeMax(id1));
+    return (cellIsValid(id1) & cellIsValid(id2)) ? result : naInt;
+  }
+};
+
+// S2CellId::intersects(), which is what S2Cell::MayIntersect() computes
+struct CellMayIntersectKernel {
+  int naInt;
+  int operator()(uint64_t id1, uint64_t id2) const {
+    bool result = (cellRangeMin(id2) <= cellRangeMax(id1)) &
+      (cellRangeMax(id2) >= cellRangeMin(id1));
+    return (cellIsValid(id1) & cellIsValid(id2)) ? result : naInt;
+  }
+};
+
+// Comparisons of cell ids, which are NA only if one of the cells is NA
+// (invalid cells such as the sentinel are compared like any other id)
+template<class Compare>
+struct CellCompareKernel {
+  int naInt;
+  int operator()(uint64_t id1, uint64_t id2) const {
+    bool result = Compare()(id1, id2);
+    return (cellIsNA(id1) | cellIsNA(id2)) ? naInt : result;
+  }
+};
+
+#endif
@@ -0,0 +1,118 @@
+
+#ifndef S2_CELL_NEIGHBOURS_H
+#define S2_CELL_NEIGHBOURS_H
+
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+#include <vector>
+
+#include "s2/s1chord_angle.h"
+#include "s2/s2cell.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2metrics.h"
+
+// Neighbourhoods of a cell are found by a breadth-first search over the
+// cells that share an edge or a vertex with each other at the level of the
+// cell (S2CellId::AppendAllNeighbors()), remembering cells that have
+// already been reached so that each cell is only output once. Near the
+// corners of the cube faces a cell has 7 rather than 8 neighbours, so rings
+// aren't always squares, but every cell within k steps is found.
+
+// Upper bounds on the number of cells in a neighbourhood, which callers
+// use to reject neighbourhoods that would be too large to compute before
+// starting (the searches below can't be interrupted). Neither can contain
+// more cells than there are at the level.
+inline double cellKRingSizeEstimate(int level, int k) {
+  double numCells = (2.0 * k + 1) * (2.0 * k + 1);
+  return std::min(numCells, 6 * std::pow(4.0, level));
+}
+
+inline double cellDiskSizeEstimate(int level, double distance) {
+  // cells in the disk are within a cap around the center of the cell, and
+  // each of them covers at least the minimum cell area
+  double capRadius = std::min(M_PI, distance + 2 * S2::kMaxDiag.GetValue(level));
+  double capArea = 2 * M_PI * (1 - std::cos(capRadius));
+  double numCells = std::ceil(capArea / S2::kMinArea.GetValue(level));
+  return std::min(numCells, 6 * std::pow(4.0, level));
+}
+
+// Appends the cells within k steps of cellId (including cellId itself) to
+// cells and the number of steps to each of them to steps, ordered by
+// the number of steps and cell id
+inline void cellKRing(S2CellId cellId, int k, std::vector<S2CellId>* cells,
+                      std::vector<int>* steps) {
+  std::unordered_set<S2CellId, S2CellIdHash> visited;
+  std::vector<S2CellId> frontier, next, neighbours;
+  int level = cellId.level();
+
+  visited.insert(cellId);
+  frontier.push_back(cellId);
+  cells->push_back(cellId);
+  steps->push_back(0);
+
+  for (int step = 1; step <= k && !frontier.empty(); step++) {
+    next.clear();
+    for (S2CellId frontierCellId: frontier) {
+      neighbours.clear();
+      frontierCellId.AppendAllNeighbors(level, &neighbours);
+      for (S2CellId neighbour: neighbours) {
+        if (visited.insert(neighbour).second) {
+          next.push_back(neighbour);
+        }
+      }
+    }
+
+    std::sort(next.begin(), next.end());
+    cells->insert(cells->end(), next.begin(), next.end());
+    steps->insert(steps->end(), next.size(), step);
+    frontier.swap(next);
+  }
+}
+
+// Appends the cells at the level of cellId whose distance to cellId is less
+// than or equal to distance (including cellId itself) to cells and their
+// distances to distances, ordered by distance and cell id. Cells within a
+// distance of a cell are connected, so the search can stop expanding at
+// cells that are too far away.
+inline void cellDisk(S2CellId cellId, S1ChordAngle distance, std::vector<S2CellId>* cells,
+                     std::vector<S1ChordAngle>* distances) {
+  std::unordered_set<S2CellId, S2CellIdHash> visited;
+  std::vector<S2CellId> frontier, next, neighbours;
+  std::vector<std::pair<S1ChordAngle, S2CellId>> found;
+  S2Cell cell(cellId);
+  int level = cellId.level();
+
+  visited.insert(cellId);
+  frontier.push_back(cellId);
+  found.emplace_back(S1ChordAngle::Zero(), cellId);
+
+  while (!frontier.empty()) {
+    next.clear();
+    for (S2CellId frontierCellId: frontier) {
+      neighbours.clear();
+      frontierCellId.AppendAllNeighbors(level, &neighbours);
+      for (S2CellId neighbour: neighbours) {
+        if (!visited.insert(neighbour).second) {
+          continue;
+        }
+
+        S1ChordAngle neighbourDistance = cell.GetDistance(S2Cell(neighbour));
+        if (neighbourDistance <= distance) {
+          next.push_back(neighbour);
+          found.emplace_back(neighbourDistance, neighbour);
+        }
+      }
+    }
+
+    frontier.swap(next);
+  }
+
+  std::sort(found.begin(), found.end());
+  for (const auto& item: found) {
+    distances->push_back(item.first);
+    cells->push_back(item.second);
+  }
+}
+
+#endif
@@ -0,0 +1,100 @@
+
+#ifndef S2_CELL_SORT_H
+#define S2_CELL_SORT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "s2-parallel.h"
+
+// Sorts cell ids (or any 64-bit keys) in increasing order using a least
+// significant digit radix sort, which makes a fixed number of passes over
+// the data rather than the O(n log n) comparisons of std::sort(). Each pass
+// distributes keys according to one 11-bit digit, and passes for digits
+// that are the same for all keys are skipped (e.g., the high bits of cells
+// near each other or the low bits of cells at low levels). Large inputs are
+// split into chunks that are counted and distributed in parallel.
+inline void radixSortCellIds(uint64_t* data, R_xlen_t n, int numThreads) {
+  const int radixBits = 11;
+  const int numBuckets = 1 << radixBits;
+  const int numDigits = (64 + radixBits - 1) / radixBits;
+  const uint64_t mask = numBuckets - 1;
+
+  // the overhead of counting isn't worth it for small inputs
+  if (n < 4096) {
+    std::sort(data, data + n);
+    return;
+  }
+
+  R_xlen_t numChunks = std::max<R_xlen_t>(
+    1,
+    std::min<R_xlen_t>(numThreads * 4, n / 65536)
+  );
+  R_xlen_t chunkSize = (n + numChunks - 1) / numChunks;
+  if (numThreads <= 1) {
+    numChunks = 1;
+    chunkSize = n;
+  }
+
+  // bits that are set in some keys but not others, so that passes for
+  // digits that are the same for all keys can be skipped
+  uint64_t allBits = 0;
+  uint64_t commonBits = ~static_cast<uint64_t>(0);
+  for (R_xlen_t i = 0; i < n; i++) {
+    allBits |= data[i];
+    commonBits &= data[i];
+  }
+  uint64_t varyingBits = allBits ^ commonBits;
+
+  std::vector<uint64_t> buffer(n);
+  uint64_t* from = data;
+  uint64_t* to = buffer.data();
+  std::vector<R_xlen_t> offsets(numChunks * numBuckets);
+
+  for (int digit = 0; digit < numDigits; digit++) {
+    int shift = digit * radixBits;
+    if (((varyingBits >> shift) & mask) == 0) {
+      continue;
+    }
+
+    // count the keys in each bucket for each chunk
+    std::fill(offsets.begin(), offsets.end(), 0);
+    parallelFor(numChunks, [&](R_xlen_t chunk) {
+      R_xlen_t* counts = offsets.data() + chunk * numBuckets;
+      R_xlen_t end = std::min(n, (chunk + 1) * chunkSize);
+      for (R_xlen_t i = chunk * chunkSize; i < end; i++) {
+        counts[(from[i] >> shift) & mask]++;
+      }
+    }, numThreads, 1);
+
+    // turn counts into the position where each chunk writes its first key
+    // for each bucket (all keys of bucket 0 first, in chunk order, and so on)
+    R_xlen_t position = 0;
+    for (int bucket = 0; bucket < numBuckets; bucket++) {
+      for (R_xlen_t chunk = 0; chunk < numChunks; chunk++) {
+        R_xlen_t count = offsets[chunk * numBuckets + bucket];
+        offsets[chunk * numBuckets + bucket] = position;
+        position += count;
+      }
+    }
+
+    parallelFor(numChunks, [&](R_xlen_t chunk) {
+      R_xlen_t* positions = offsets.data() + chunk * numBuckets;
+      R_xlen_t end = std::min(n, (chunk + 1) * chunkSize);
+      for (R_xlen_t i = chunk * chunkSize; i < end; i++) {
+        uint64_t value = from[i];
+        to[positions[(value >> shift) & mask]++] = value;
+      }
+    }, numThreads, 1);
+
+    std::swap(from, to);
+  }
+
+  if (from != data) {
+    std::memcpy(data, from, n * sizeof(uint64_t));
+  }
+}
+
+#endif
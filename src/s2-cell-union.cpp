@@ -0,0 +1,289 @@
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "s2/s2cell_id.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2polygon.h"
+
+#include "polygon-geography.h"
+#include "s2-cell-union.h"
+
+#include <Rcpp.h>
+using namespace Rcpp;
+
+static std::vector<S2CellId> cellIdsFromItem(SEXP item) {
+  const uint64_t* ids = (const uint64_t*) REAL(item);
+  std::vector<S2CellId> cellIds;
+  cellIds.reserve(Rf_xlength(item));
+  for (R_xlen_t i = 0; i < Rf_xlength(item); i++) {
+    cellIds.push_back(S2CellId(ids[i]));
+  }
+
+  return cellIds;
+}
+
+S2CellUnion cellUnionFromItem(SEXP item) {
+  return S2CellUnion::FromVerbatim(cellIdsFromItem(item));
+}
+
+SEXP cellUnionToItem(const S2CellUnion& cellUnion) {
+  NumericVector item(cellUnion.num_cells());
+  memcpy(REAL(item), cellUnion.cell_ids().data(), cellUnion.num_cells() * sizeof(uint64_t));
+  return item;
+}
+
+template<class VectorType, class ScalarType>
+class UnaryCellUnionOperator {
+public:
+  VectorType processVector(List cellUnionVector) {
+    VectorType output(cellUnionVector.size());
+
+    for (R_xlen_t i = 0; i < cellUnionVector.size(); i++) {
+      if ((i % 1000) == 0) {
+        checkUserInterrupt();
+      }
+
+      SEXP item = cellUnionVector[i];
+      if (item == R_NilValue) {
+        output[i] = VectorType::get_na();
+      } else {
+        output[i] = this->processUnion(cellUnionFromItem(item), i);
+      }
+    }
+
+    return output;
+  }
+
+  virtual ScalarType processUnion(const S2CellUnion& cellUnion, R_xlen_t i) = 0;
+};
+
+// Binary operators between cell unions and cell unions (Item = List) or
+// cells (Item = NumericVector). As in BinaryS2CellOperator, vectors of
+// length 1 are recycled here.
+template<class VectorType, class ScalarType, class ItemVectorType>
+class BinaryCellUnionOperator {
+public:
+  VectorType processVector(List cellUnionVector, ItemVectorType itemVector) {
+    R_xlen_t size;
+    if (cellUnionVector.size() == itemVector.size()) {
+      size = cellUnionVector.size();
+    } else if (cellUnionVector.size() == 1) {
+      size = itemVector.size();
+    } else if (itemVector.size() == 1) {
+      size = cellUnionVector.size();
+    } else {
+      stop("Can't recycle vectors of incompatible sizes");
+    }
+
+    VectorType output(size);
+    for (R_xlen_t i = 0; i < size; i++) {
+      if ((i % 1000) == 0) {
+        checkUserInterrupt();
+      }
+
+      SEXP item1 = cellUnionVector[cellUnionVector.size() == 1 ? 0 : i];
+      R_xlen_t j = itemVector.size() == 1 ? 0 : i;
+      if (item1 == R_NilValue || this->isMissing(itemVector, j)) {
+        output[i] = VectorType::get_na();
+      } else {
+        output[i] = this->processItem(cellUnionFromItem(item1), itemVector, j, i);
+      }
+    }
+
+    return output;
+  }
+
+  virtual ScalarType processItem(const S2CellUnion& cellUnion, ItemVectorType itemVector,
+                                 R_xlen_t j, R_xlen_t i) = 0;
+
+private:
+  bool isMissing(List itemVector, R_xlen_t j) {
+    return itemVector[j] == R_NilValue;
+  }
+
+  bool isMissing(NumericVector itemVector, R_xlen_t j) {
+    return R_IsNA(itemVector[j]);
+  }
+};
+
+template<class VectorType, class ScalarType>
+class BinaryCellUnionUnionOperator: public BinaryCellUnionOperator<VectorType, ScalarType, List> {
+public:
+  ScalarType processItem(const S2CellUnion& cellUnion, List itemVector, R_xlen_t j, R_xlen_t i) {
+    return this->processUnions(cellUnion, cellUnionFromItem(itemVector[j]), i);
+  }
+
+  virtual ScalarType processUnions(const S2CellUnion& cellUnion1, const S2CellUnion& cellUnion2,
+                                   R_xlen_t i) = 0;
+};
+
+template<class VectorType, class ScalarType>
+class BinaryCellUnionCellOperator: public BinaryCellUnionOperator<VectorType, ScalarType, NumericVector> {
+public:
+  ScalarType processItem(const S2CellUnion& cellUnion, NumericVector itemVector, R_xlen_t j, R_xlen_t i) {
+    uint64_t id;
+    memcpy(&id, &(itemVector[j]), sizeof(uint64_t));
+    S2CellId cellId(id);
+    if (!cellId.is_valid()) {
+      stop("Can't use an invalid cell (at index %d)", i + 1);
+    }
+
+    return this->processCell(cellUnion, cellId, i);
+  }
+
+  virtual ScalarType processCell(const S2CellUnion& cellUnion, S2CellId cellId, R_xlen_t i) = 0;
+};
+
+// [[Rcpp::export]]
+List cpp_s2_cell_union_normalize(List cellIdsList) {
+  List output(cellIdsList.size());
+
+  for (R_xlen_t i = 0; i < cellIdsList.size(); i++) {
+    SEXP item = cellIdsList[i];
+    if (item == R_NilValue) {
+      output[i] = R_NilValue;
+      continue;
+    }
+
+    std::vector<S2CellId> cellIds = cellIdsFromItem(item);
+    for (const S2CellId& cellId: cellIds) {
+      if (!cellId.is_valid()) {
+        stop("Can't create a cell union from invalid or missing cells (at index %d)", i + 1);
+      }
+    }
+
+    output[i] = cellUnionToItem(S2CellUnion(std::move(cellIds)));
+  }
+
+  return output;
+}
+
+// [[Rcpp::export]]
+List cpp_s2_cell_union_from_cell(NumericVector cellIdVector) {
+  List output(cellIdVector.size());
+
+  for (R_xlen_t i = 0; i < cellIdVector.size(); i++) {
+    uint64_t id;
+    memcpy(&id, &(cellIdVector[i]), sizeof(uint64_t));
+    S2CellId cellId(id);
+    if (cellId.is_valid()) {
+      output[i] = cellUnionToItem(S2CellUnion::FromVerbatim({cellId}));
+    } else {
+      output[i] = R_NilValue;
+    }
+  }
+
+  return output;
+}
+
+// [[Rcpp::export]]
+List cpp_s2_cell_union_union(List cellUnionVector1, List cellUnionVector2) {
+  class Op: public BinaryCellUnionUnionOperator<List, SEXP> {
+    SEXP processUnions(const S2CellUnion& cellUnion1, const S2CellUnion& cellUnion2, R_xlen_t i) {
+      return cellUnionToItem(cellUnion1.Union(cellUnion2));
+    }
+  };
+
+  Op op;
+  return op.processVector(cellUnionVector1, cellUnionVector2);
+}
+
+// [[Rcpp::export]]
+List cpp_s2_cell_union_intersection(List cellUnionVector1, List cellUnionVector2) {
+  class Op: public BinaryCellUnionUnionOperator<List, SEXP> {
+    SEXP processUnions(const S2CellUnion& cellUnion1, const S2CellUnion& cellUnion2, R_xlen_t i) {
+      return cellUnionToItem(cellUnion1.Intersection(cellUnion2));
+    }
+  };
+
+  Op op;
+  return op.processVector(cellUnionVector1, cellUnionVector2);
+}
+
+// [[Rcpp::export]]
+List cpp_s2_cell_union_difference(List cellUnionVector1, List cellUnionVector2) {
+  class Op: public BinaryCellUnionUnionOperator<List, SEXP> {
+    SEXP processUnions(const S2CellUnion& cellUnion1, const S2CellUnion& cellUnion2, R_xlen_t i) {
+      return cellUnionToItem(cellUnion1.Difference(cellUnion2));
+    }
+  };
+
+  Op op;
+  return op.processVector(cellUnionVector1, cellUnionVector2);
+}
+
+// [[Rcpp::export]]
+LogicalVector cpp_s2_cell_union_contains(List cellUnionVector1, List cellUnionVector2) {
+  class Op: public BinaryCellUnionUnionOperator<LogicalVector, int> {
+    int processUnions(const S2CellUnion& cellUnion1, const S2CellUnion& cellUnion2, R_xlen_t i) {
+      return cellUnion1.Contains(cellUnion2);
+    }
+  };
+
+  Op op;
+  return op.processVector(cellUnionVector1, cellUnionVector2);
+}
+
+// [[Rcpp::export]]
+LogicalVector cpp_s2_cell_union_intersects(List cellUnionVector1, List cellUnionVector2) {
+  class Op: public BinaryCellUnionUnionOperator<LogicalVector, int> {
+    int processUnions(const S2CellUnion& cellUnion1, const S2CellUnion& cellUnion2, R_xlen_t i) {
+      return cellUnion1.Intersects(cellUnion2);
+    }
+  };
+
+  Op op;
+  return op.processVector(cellUnionVector1, cellUnionVector2);
+}
+
+// [[Rcpp::export]]
+LogicalVector cpp_s2_cell_union_contains_cell(List cellUnionVector, NumericVector cellIdVector) {
+  class Op: public BinaryCellUnionCellOperator<LogicalVector, int> {
+    int processCell(const S2CellUnion& cellUnion, S2CellId cellId, R_xlen_t i) {
+      return cellUnion.Contains(cellId);
+    }
+  };
+
+  Op op;
+  return op.processVector(cellUnionVector, cellIdVector);
+}
+
+// [[Rcpp::export]]
+LogicalVector cpp_s2_cell_union_intersects_cell(List cellUnionVector, NumericVector cellIdVector) {
+  class Op: public BinaryCellUnionCellOperator<LogicalVector, int> {
+    int processCell(const S2CellUnion& cellUnion, S2CellId cellId, R_xlen_t i) {
+      return cellUnion.Intersects(cellId);
+    }
+  };
+
+  Op op;
+  return op.processVector(cellUnionVector, cellIdVector);
+}
+
+// [[Rcpp::export]]
+NumericVector cpp_s2_cell_union_area(List cellUnionVector) {
+  class Op: public UnaryCellUnionOperator<NumericVector, double> {
+    double processUnion(const S2CellUnion& cellUnion, R_xlen_t i) {
+      return cellUnion.ExactArea();
+    }
+  };
+
+  Op op;
+  return op.processVector(cellUnionVector);
+}
+
+// [[Rcpp::export]]
+List cpp_s2_geography_from_cell_union(List cellUnionVector) {
+  class Op: public UnaryCellUnionOperator<List, SEXP> {
+    SEXP processUnion(const S2CellUnion& cellUnion, R_xlen_t i) {
+      std::unique_ptr<S2Polygon> polygon = absl::make_unique<S2Polygon>();
+      polygon->InitToCellUnionBorder(cellUnion);
+      return XPtr<PolygonGeography>(new PolygonGeography(std::move(polygon)));
+    }
+  };
+
+  Op op;
+  return op.processVector(cellUnionVector);
+}
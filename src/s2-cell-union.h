@@ -0,0 +1,13 @@
+
+#ifndef S2_CELL_UNION_H
+#define S2_CELL_UNION_H
+
+#include "s2/s2cell_union.h"
+#include <Rcpp.h>
+
+// Cell unions are stored in R as a list() of double vectors containing the
+// (normalized) cell ids, with NULL for missing unions
+S2CellUnion cellUnionFromItem(SEXP item);
+SEXP cellUnionToItem(const S2CellUnion& cellUnion);
+
+#endif
@@ -1,9 +1,9 @@
 
+#include <climits>
 #include <cstdint>
 #include <vector>
 #include <sstream>
 #include <algorithm>
-#include <set>
 
 #include "s2/s2cell_id.h"
 #include "s2/s2cell.h"
@@ -12,6 +12,10 @@
 #include "point-geography.h"
 #include "polyline-geography.h"
 #include "polygon-geography.h"
+#include "s2-cell-bin.h"
+#include "s2-cell-kernels.h"
+#include "s2-cell-neighbours.h"
+#include "s2-cell-sort.h"
 
 #include <Rcpp.h>
 using namespace Rcpp;
@@ -22,6 +26,65 @@ static inline double reinterpret_double(uint64_t id) {
   return doppelganger;
 }
 
+static inline uint64_t naRealBits() {
+  uint64_t bits;
+  memcpy(&bits, &NA_REAL, sizeof(uint64_t));
+  return bits;
+}
+
+// Kernels from s2-cell-kernels.h process cells in blocks of this size
+// between checks for user interrupts (and, for kernels that are expensive
+// enough to be worth it, blocks are processed in parallel)
+static const R_xlen_t cellKernelBlockSize = 65536;
+
+template<class BlockFunction>
+void processCellBlocks(R_xlen_t size, BlockFunction processBlock, int numThreads = 1) {
+  R_xlen_t numBlocks = (size + cellKernelBlockSize - 1) / cellKernelBlockSize;
+  parallelFor(numBlocks, [&](R_xlen_t block) {
+    R_xlen_t start = block * cellKernelBlockSize;
+    processBlock(start, std::min(cellKernelBlockSize, size - start));
+  }, numThreads, 1);
+}
+
+// Applies a binary kernel to two cell vectors, recycling vectors of length 1
+// as BinaryS2CellOperator does
+template<class Kernel>
+LogicalVector processCellKernel(NumericVector cellIdVector1, NumericVector cellIdVector2,
+                                Kernel kernel) {
+  R_xlen_t size;
+  if (cellIdVector1.size() == cellIdVector2.size()) {
+    size = cellIdVector1.size();
+  } else if (cellIdVector1.size() == 1) {
+    size = cellIdVector2.size();
+  } else if (cellIdVector2.size() == 1) {
+    size = cellIdVector1.size();
+  } else {
+    std::stringstream err;
+    err <<
+      "Can't recycle vectors of size " << cellIdVector1.size() <<
+      " and " << cellIdVector2.size() <<
+      " to a common length.";
+    stop(err.str());
+  }
+
+  LogicalVector output(size);
+  bool recycle1 = cellIdVector1.size() != size;
+  bool recycle2 = cellIdVector2.size() != size;
+  const uint64_t* ids1 = (const uint64_t*) REAL(cellIdVector1);
+  const uint64_t* ids2 = (const uint64_t*) REAL(cellIdVector2);
+  int* out = LOGICAL(output);
+
+  processCellBlocks(size, [&](R_xlen_t start, R_xlen_t n) {
+    cellBinaryBatch(
+      recycle1 ? ids1 : ids1 + start, recycle1,
+      recycle2 ? ids2 : ids2 + start, recycle2,
+      n, out + start, kernel
+    );
+  });
+
+  return output;
+}
+
 class S2CellOperatorException: public std::runtime_error {
 public:
   S2CellOperatorException(std::string msg): std::runtime_error(msg.c_str()) {}
@@ -121,51 +184,50 @@ NumericVector cpp_s2_cell_sentinel() {
 
 // [[Rcpp::export]]
 NumericVector cpp_s2_cell_from_string(CharacterVector cellString) {
-  R_xlen_t size = cellString.size();
-  NumericVector cellId(size);
-  double* ptrDouble = REAL(cellId);
-  uint64_t* ptrCellId = (uint64_t*) ptrDouble;
-
-  for (R_xlen_t i = 0; i < size; i++) {
-    if ((i % 1000) == 0) {
-      Rcpp::checkUserInterrupt();
+  NumericVector cellId(cellString.size());
+  uint64_t* ptrCellId = (uint64_t*) REAL(cellId);
+  uint64_t naBits = naRealBits();
+
+  // tokens are parsed from the bytes of each CHARSXP without copying them
+  processCellBlocks(cellId.size(), [&](R_xlen_t start, R_xlen_t n) {
+    for (R_xlen_t i = start; i < (start + n); i++) {
+      SEXP item = STRING_ELT(cellString, i);
+      if (item == NA_STRING) {
+        ptrCellId[i] = naBits;
+      } else {
+        ptrCellId[i] = cellFromToken(CHAR(item), LENGTH(item));
+      }
     }
+  });
 
-    if (CharacterVector::is_na(cellString[i])) {
-      ptrDouble[i] = NA_REAL;
-    } else {
-      ptrCellId[i] = S2CellId::FromToken(as<std::string>(cellString[i])).id();
-    }
-  }
-  
   cellId.attr("class") = CharacterVector::create("s2_cell", "wk_vctr");
   return cellId;
 }
 
 // [[Rcpp::export]]
-NumericVector cpp_s2_cell_from_lnglat(List lnglat) {
-    NumericVector lng = lnglat[0];
-    NumericVector lat = lnglat[1];
-    R_xlen_t size = lng.size();
-    NumericVector cellId(size);
-    double* ptrDouble = REAL(cellId);
-    uint64_t* ptrCellId = (uint64_t*) ptrDouble;
+NumericVector cpp_s2_cell_from_lnglat(List lnglat, int level, int numThreads) {
+  if (level < 0 || level > S2CellId::kMaxLevel) {
+    stop("`level` must be an integer between 0 and 30");
+  }
 
-    for (R_xlen_t i = 0; i < size; i++) {
-      if ((i % 1000) == 0) {
-        Rcpp::checkUserInterrupt();
-      }
+  NumericVector lng = lnglat[0];
+  NumericVector lat = lnglat[1];
+  if (lat.size() != lng.size()) {
+    stop("Longitude and latitude vectors must have the same length");
+  }
 
-      if (R_IsNA(lng[i]) || R_IsNA(lat[i])) {
-          ptrDouble[i] = NA_REAL;
-      } else {
-          S2LatLng ll = S2LatLng::FromDegrees(lat[i], lng[i]).Normalized();
-          ptrCellId[i] = S2CellId(ll).id();
-      }
-    }
+  NumericVector cellId(lng.size());
+  const double* ptrLng = REAL(lng);
+  const double* ptrLat = REAL(lat);
+  uint64_t* ptrCellId = (uint64_t*) REAL(cellId);
+  uint64_t naBits = naRealBits();
+
+  processCellBlocks(cellId.size(), [&](R_xlen_t start, R_xlen_t n) {
+    cellFromLngLatBatch(ptrLng + start, ptrLat + start, n, level, ptrCellId + start, naBits);
+  }, numThreads);
 
-    cellId.attr("class") = CharacterVector::create("s2_cell", "wk_vctr");
-    return cellId;
+  cellId.attr("class") = CharacterVector::create("s2_cell", "wk_vctr");
+  return cellId;
 }
 
 // [[Rcpp::export]]
@@ -203,22 +265,24 @@ List cpp_s2_cell_to_lnglat(NumericVector cellId) {
 
 // [[Rcpp::export]]
 LogicalVector cpp_s2_cell_is_na(NumericVector cellIdVector) {
-  LogicalVector out(cellIdVector.size());
-  for (R_xlen_t i = 0; i < cellIdVector.size(); i++) {
-    out = R_IsNA(cellIdVector[i]);
-  }
-  return out;
+  LogicalVector output(cellIdVector.size());
+  const uint64_t* ids = (const uint64_t*) REAL(cellIdVector);
+  int* out = LOGICAL(output);
+  processCellBlocks(output.size(), [&](R_xlen_t start, R_xlen_t n) {
+    cellIsNABatch(ids + start, n, out + start);
+  });
+
+  return output;
 }
 
 // [[Rcpp::export]]
-NumericVector cpp_s2_cell_sort(NumericVector cellIdVector, bool decreasing) {
+NumericVector cpp_s2_cell_sort(NumericVector cellIdVector, bool decreasing, int numThreads) {
   NumericVector out = clone(cellIdVector);
   uint64_t* data = (uint64_t*) REAL(out);
 
+  radixSortCellIds(data, out.size(), numThreads);
   if (decreasing) {
-    std::sort(data, data + out.size(), std::greater<uint64_t>());
-  } else {
-    std::sort(data, data + out.size());
+    std::reverse(data, data + out.size());
   }
 
   out.attr("class") = CharacterVector::create("s2_cell", "wk_vctr");
@@ -265,66 +329,176 @@ NumericVector cpp_s2_cell_range(NumericVector cellIdVector, bool naRm) {
 }
 
 // [[Rcpp::export]]
-NumericVector cpp_s2_cell_unique(NumericVector cellIdVector) {
-  std::set<uint64_t> uniqueValues;
-  uint64_t value;
-  for (R_xlen_t i = 0; i < cellIdVector.size(); i++) {
-    memcpy(&value, &(cellIdVector[i]), sizeof(uint64_t));
-    uniqueValues.insert(value);
+NumericVector cpp_s2_cell_unique(NumericVector cellIdVector, int numThreads) {
+  std::vector<uint64_t> values(cellIdVector.size());
+  memcpy(values.data(), REAL(cellIdVector), values.size() * sizeof(uint64_t));
+  radixSortCellIds(values.data(), values.size(), numThreads);
+  values.erase(std::unique(values.begin(), values.end()), values.end());
+
+  NumericVector out(values.size());
+  memcpy(REAL(out), values.data(), values.size() * sizeof(uint64_t));
+  out.attr("class") = CharacterVector::create("s2_cell", "wk_vctr");
+  return out;
+}
+
+// [[Rcpp::export]]
+List cpp_s2_cell_count(NumericVector cellIdVector, int numThreads) {
+  std::vector<uint64_t> values(cellIdVector.size());
+  memcpy(values.data(), REAL(cellIdVector), values.size() * sizeof(uint64_t));
+  radixSortCellIds(values.data(), values.size(), numThreads);
+
+  // run lengths of the sorted values, compacting values in place
+  std::vector<R_xlen_t> counts;
+  size_t numUnique = 0;
+  for (size_t i = 0; i < values.size(); i++) {
+    if (i > 0 && values[i] == values[numUnique - 1]) {
+      counts[numUnique - 1]++;
+    } else {
+      values[numUnique++] = values[i];
+      counts.push_back(1);
+    }
   }
 
-  NumericVector out(uniqueValues.size());
-  R_xlen_t i = 0;
-  for (uint64_t value : uniqueValues) {
-    out[i++] = reinterpret_double(value);
+  NumericVector cell(numUnique);
+  memcpy(REAL(cell), values.data(), numUnique * sizeof(uint64_t));
+  cell.attr("class") = CharacterVector::create("s2_cell", "wk_vctr");
+
+  IntegerVector count(numUnique);
+  for (size_t i = 0; i < numUnique; i++) {
+    if (counts[i] > INT_MAX) {
+      stop("Cell %s occurs more than %d times", S2CellId(values[i]).ToToken(), INT_MAX);
+    }
+
+    count[i] = counts[i];
   }
 
-  out.attr("class") = CharacterVector::create("s2_cell", "wk_vctr");
-  return out;
+  return List::create(_["cell"] = cell, _["count"] = count);
 }
 
 // [[Rcpp::export]]
-CharacterVector cpp_s2_cell_to_string(NumericVector cellIdVector) {
-  class Op: public UnaryS2CellOperator<CharacterVector, String> {
-    String processCell(S2CellId cellId, R_xlen_t i) {
-      if (R_IsNA(reinterpret_double(cellId.id()))) {
-        return NA_STRING;
-      } else {
-        return cellId.ToToken();
+List cpp_s2_cell_bin(List lnglat, int level, NumericVector weights, bool weighted,
+                     int numThreads) {
+  if (level < 0 || level > S2CellId::kMaxLevel) {
+    stop("`level` must be an integer between 0 and 30");
+  }
+
+  NumericVector lng = lnglat[0];
+  NumericVector lat = lnglat[1];
+  R_xlen_t size = lng.size();
+  if (lat.size() != size) {
+    stop("Longitude and latitude vectors must have the same length");
+  }
+
+  if (weighted && weights.size() != size) {
+    stop("`weights` must be the same length as `x`");
+  }
+
+  const double* ptrLng = REAL(lng);
+  const double* ptrLat = REAL(lat);
+  const double* ptrWeights = weighted ? REAL(weights) : nullptr;
+  uint64_t naBits = naRealBits();
+
+  // Each block of points is binned into its own table and the tables of a
+  // round of blocks are merged in block order, which keeps memory bounded
+  // and sums independent of the number of threads
+  R_xlen_t numBlocks = (size + cellKernelBlockSize - 1) / cellKernelBlockSize;
+  R_xlen_t roundSize = std::max(1, numThreads) * 4;
+  std::vector<CellBinTable> tables(std::min(roundSize, numBlocks));
+  CellBinTable bins;
+
+  for (R_xlen_t roundStart = 0; roundStart < numBlocks; roundStart += roundSize) {
+    R_xlen_t roundBlocks = std::min(roundSize, numBlocks - roundStart);
+    parallelFor(roundBlocks, [&](R_xlen_t k) {
+      CellBinTable& table = tables[k];
+      table.clear();
+
+      R_xlen_t blockStart = (roundStart + k) * cellKernelBlockSize;
+      R_xlen_t blockEnd = std::min(size, blockStart + cellKernelBlockSize);
+      const R_xlen_t chunkSize = 256;
+      uint64_t ids[chunkSize];
+      for (R_xlen_t start = blockStart; start < blockEnd; start += chunkSize) {
+        R_xlen_t n = std::min(chunkSize, blockEnd - start);
+        cellFromLngLatBatch(ptrLng + start, ptrLat + start, n, level, ids, naBits);
+        for (R_xlen_t i = 0; i < n; i++) {
+          table.add(ids[i], 1, weighted ? ptrWeights[start + i] : 0);
+        }
       }
+    }, numThreads, 1);
+
+    for (R_xlen_t k = 0; k < roundBlocks; k++) {
+      bins.merge(tables[k]);
     }
-  };
+  }
 
-  Op op;
-  return op.processVector(cellIdVector);
+  NumericVector cell(bins.size());
+  uint64_t* ptrCell = (uint64_t*) REAL(cell);
+  IntegerVector count(bins.size());
+  NumericVector sum(weighted ? bins.size() : 0);
+  R_xlen_t i = 0;
+  bins.forEachSorted([&](uint64_t id, int64_t idCount, double idSum) {
+    if (idCount > INT_MAX) {
+      stop("Cell %s contains more than %d points", S2CellId(id).ToToken(), INT_MAX);
+    }
+
+    ptrCell[i] = id;
+    count[i] = idCount;
+    if (weighted) {
+      sum[i] = idSum;
+    }
+    i++;
+  });
+
+  cell.attr("class") = CharacterVector::create("s2_cell", "wk_vctr");
+  if (weighted) {
+    return List::create(_["cell"] = cell, _["count"] = count, _["sum"] = sum);
+  } else {
+    return List::create(_["cell"] = cell, _["count"] = count);
+  }
 }
 
-// [[Rcpp::export]]
-CharacterVector cpp_s2_cell_debug_string(NumericVector cellIdVector) {
-  class Op: public UnaryS2CellOperator<CharacterVector, String> {
-    String processCell(S2CellId cellId, R_xlen_t i) {
-      if (R_IsNA(reinterpret_double(cellId.id()))) {
-        return NA_STRING;
+// Formats each cell into a buffer on the stack with format(id, buffer)
+// (which returns the number of characters written), creating the CHARSXP
+// directly from the buffer
+template<class Format>
+CharacterVector formatCells(NumericVector cellIdVector, Format format) {
+  CharacterVector output(cellIdVector.size());
+  const uint64_t* ids = (const uint64_t*) REAL(cellIdVector);
+  char buffer[32];
+
+  processCellBlocks(output.size(), [&](R_xlen_t start, R_xlen_t n) {
+    for (R_xlen_t i = start; i < (start + n); i++) {
+      if (cellIsNA(ids[i])) {
+        SET_STRING_ELT(output, i, NA_STRING);
       } else {
-        return cellId.ToString();
+        int length = format(ids[i], buffer);
+        SET_STRING_ELT(output, i, Rf_mkCharLenCE(buffer, length, CE_UTF8));
       }
     }
-  };
+  });
 
-  Op op;
-  return op.processVector(cellIdVector);
+  return output;
+}
+
+// [[Rcpp::export]]
+CharacterVector cpp_s2_cell_to_string(NumericVector cellIdVector) {
+  return formatCells(cellIdVector, cellToToken);
+}
+
+// [[Rcpp::export]]
+CharacterVector cpp_s2_cell_debug_string(NumericVector cellIdVector) {
+  return formatCells(cellIdVector, cellToDebugString);
 }
 
 // [[Rcpp::export]]
 LogicalVector cpp_s2_cell_is_valid(NumericVector cellIdVector) {
-  class Op: public UnaryS2CellOperator<LogicalVector, int> {
-    int processCell(S2CellId cellId, R_xlen_t i) {
-      return cellId.is_valid();
-    }
-  };
+  LogicalVector output(cellIdVector.size());
+  const uint64_t* ids = (const uint64_t*) REAL(cellIdVector);
+  int* out = LOGICAL(output);
+  processCellBlocks(output.size(), [&](R_xlen_t start, R_xlen_t n) {
+    cellIsValidBatch(ids + start, n, out + start);
+  });
 
-  Op op;
-  return op.processVector(cellIdVector);
+  return output;
 }
 
 // [[Rcpp::export]]
@@ -387,18 +561,14 @@ List cpp_s2_cell_vertex(NumericVector cellIdVector, IntegerVector k) {
 
 // [[Rcpp::export]]
 IntegerVector cpp_s2_cell_level(NumericVector cellIdVector) {
-  class Op: public UnaryS2CellOperator<IntegerVector, int> {
-    int processCell(S2CellId cellId, R_xlen_t i) {
-      if (cellId.is_valid()) {
-        return cellId.level();
-      } else {
-        return NA_INTEGER;
-      }
-    }
-  };
+  IntegerVector output(cellIdVector.size());
+  const uint64_t* ids = (const uint64_t*) REAL(cellIdVector);
+  int* out = INTEGER(output);
+  processCellBlocks(output.size(), [&](R_xlen_t start, R_xlen_t n) {
+    cellLevelBatch(ids + start, n, out + start, NA_INTEGER);
+  });
 
-  Op op;
-  return op.processVector(cellIdVector);
+  return output;
 }
 
 // [[Rcpp::export]]
@@ -435,29 +605,49 @@ NumericVector cpp_s2_cell_area_approx(NumericVector cellIdVector) {
 
 // [[Rcpp::export]]
 NumericVector cpp_s2_cell_parent(NumericVector cellIdVector, IntegerVector level) {
-  class Op: public UnaryS2CellOperator<NumericVector, double> {
-    double processCell(S2CellId cellId, R_xlen_t i) {
-      int leveli = this->level[i];
+  if (level.size() != cellIdVector.size()) {
+    stop("`level` must be the same length as `x`");
+  }
 
-      // allow negative numbers to relate to current level
-      if (leveli < 0) {
-        leveli = cellId.level() + leveli;
-      }
+  NumericVector result(cellIdVector.size());
+  const uint64_t* ids = (const uint64_t*) REAL(cellIdVector);
+  const int* levels = INTEGER(level);
+  uint64_t* out = (uint64_t*) REAL(result);
+  uint64_t naBits = naRealBits();
 
-      if (cellId.is_valid() && (leveli >= 0) && (leveli <= cellId.level())) {
-        return reinterpret_double(cellId.parent(leveli).id());
-      } else {
-        return NA_REAL;
-      }
-    }
+  // negative levels are relative to the current level
+  processCellBlocks(result.size(), [&](R_xlen_t start, R_xlen_t n) {
+    cellParentBatch(ids + start, levels + start, n, out + start, naBits);
+  });
 
-  public:
-    IntegerVector level;
-  };
+  result.attr("class") = CharacterVector::create("s2_cell", "wk_vctr");
+  return result;
+}
+
+// [[Rcpp::export]]
+NumericVector cpp_s2_cell_range_min(NumericVector cellIdVector) {
+  NumericVector result(cellIdVector.size());
+  const uint64_t* ids = (const uint64_t*) REAL(cellIdVector);
+  uint64_t* out = (uint64_t*) REAL(result);
+  uint64_t naBits = naRealBits();
+  processCellBlocks(result.size(), [&](R_xlen_t start, R_xlen_t n) {
+    cellRangeMinBatch(ids + start, n, out + start, naBits);
+  });
+
+  result.attr("class") = CharacterVector::create("s2_cell", "wk_vctr");
+  return result;
+}
+
+// [[Rcpp::export]]
+NumericVector cpp_s2_cell_range_max(NumericVector cellIdVector) {
+  NumericVector result(cellIdVector.size());
+  const uint64_t* ids = (const uint64_t*) REAL(cellIdVector);
+  uint64_t* out = (uint64_t*) REAL(result);
+  uint64_t naBits = naRealBits();
+  processCellBlocks(result.size(), [&](R_xlen_t start, R_xlen_t n) {
+    cellRangeMaxBatch(ids + start, n, out + start, naBits);
+  });
 
-  Op op;
-  op.level = level;
-  NumericVector result = op.processVector(cellIdVector);
   result.attr("class") = CharacterVector::create("s2_cell", "wk_vctr");
   return result;
 }
@@ -510,6 +700,126 @@ NumericVector cpp_s2_cell_edge_neighbour(NumericVector cellIdVector, IntegerVect
   return result;
 }
 
+// Computes the neighbourhood of each valid cell in parallel (R objects can't
+// be created on worker threads) and returns the row offsets of each cell's
+// neighbours (CSR style) so that the caller can flatten them in order
+template<class Value, class Neighbourhood>
+std::vector<R_xlen_t> cellNeighbourhoods(NumericVector cellIdVector, int numThreads,
+                                         std::vector<std::vector<S2CellId>>* cells,
+                                         std::vector<std::vector<Value>>* values,
+                                         Neighbourhood neighbourhood) {
+  R_xlen_t size = cellIdVector.size();
+  const uint64_t* ids = (const uint64_t*) REAL(cellIdVector);
+  cells->resize(size);
+  values->resize(size);
+
+  parallelFor(size, [&](R_xlen_t i) {
+    S2CellId cellId(ids[i]);
+    if (cellId.is_valid()) {
+      neighbourhood(cellId, &(*cells)[i], &(*values)[i]);
+    }
+  }, numThreads, 64);
+
+  std::vector<R_xlen_t> offsets(size + 1, 0);
+  for (R_xlen_t i = 0; i < size; i++) {
+    offsets[i + 1] = offsets[i] + (*cells)[i].size();
+  }
+
+  return offsets;
+}
+
+static inline NumericVector flattenNeighbourCells(const std::vector<std::vector<S2CellId>>& cells,
+                                                  const std::vector<R_xlen_t>& offsets,
+                                                  IntegerVector* x) {
+  NumericVector cell(offsets.back());
+  uint64_t* ptrCell = (uint64_t*) REAL(cell);
+  for (size_t i = 0; i < cells.size(); i++) {
+    for (size_t j = 0; j < cells[i].size(); j++) {
+      ptrCell[offsets[i] + j] = cells[i][j].id();
+      (*x)[offsets[i] + j] = i + 1;
+    }
+  }
+
+  cell.attr("class") = CharacterVector::create("s2_cell", "wk_vctr");
+  return cell;
+}
+
+// The maximum total number of cells in the neighbourhoods computed by one
+// call to s2_cell_k_ring() or s2_cell_disk()
+static const double maxNeighbourhoodCells = 1e8;
+
+template<class Estimate>
+void checkNeighbourhoodSize(NumericVector cellIdVector, Estimate estimate) {
+  const uint64_t* ids = (const uint64_t*) REAL(cellIdVector);
+  double numCells = 0;
+  for (R_xlen_t i = 0; i < cellIdVector.size(); i++) {
+    if (cellIsValid(ids[i])) {
+      numCells += estimate(cellLevel(ids[i]));
+    }
+  }
+
+  if (numCells > maxNeighbourhoodCells) {
+    stop(
+      "Neighbourhoods would contain about %.0f cells (more than %.0f)",
+      numCells, maxNeighbourhoodCells
+    );
+  }
+}
+
+// [[Rcpp::export]]
+List cpp_s2_cell_k_ring(NumericVector cellIdVector, int k, int numThreads) {
+  checkNeighbourhoodSize(cellIdVector, [k](int level) {
+    return cellKRingSizeEstimate(level, k);
+  });
+
+  std::vector<std::vector<S2CellId>> cells;
+  std::vector<std::vector<int>> steps;
+  std::vector<R_xlen_t> offsets = cellNeighbourhoods(
+    cellIdVector, numThreads, &cells, &steps,
+    [k](S2CellId cellId, std::vector<S2CellId>* cells, std::vector<int>* steps) {
+      cellKRing(cellId, k, cells, steps);
+    }
+  );
+
+  IntegerVector x(offsets.back());
+  NumericVector cell = flattenNeighbourCells(cells, offsets, &x);
+  IntegerVector step(offsets.back());
+  for (size_t i = 0; i < steps.size(); i++) {
+    std::copy(steps[i].begin(), steps[i].end(), step.begin() + offsets[i]);
+  }
+
+  return List::create(_["x"] = x, _["cell"] = cell, _["k"] = step);
+}
+
+// [[Rcpp::export]]
+List cpp_s2_cell_disk(NumericVector cellIdVector, double distance, int numThreads) {
+  checkNeighbourhoodSize(cellIdVector, [distance](int level) {
+    return cellDiskSizeEstimate(level, distance);
+  });
+
+  S1ChordAngle maxDistance = S1ChordAngle::Radians(distance);
+  std::vector<std::vector<S2CellId>> cells;
+  std::vector<std::vector<S1ChordAngle>> distances;
+  std::vector<R_xlen_t> offsets = cellNeighbourhoods(
+    cellIdVector, numThreads, &cells, &distances,
+    [maxDistance](S2CellId cellId, std::vector<S2CellId>* cells,
+                  std::vector<S1ChordAngle>* distances) {
+      cellDisk(cellId, maxDistance, cells, distances);
+    }
+  );
+
+  IntegerVector x(offsets.back());
+  NumericVector cell = flattenNeighbourCells(cells, offsets, &x);
+  NumericVector cellDistance(offsets.back());
+  for (size_t i = 0; i < distances.size(); i++) {
+    for (size_t j = 0; j < distances[i].size(); j++) {
+      cellDistance[offsets[i] + j] = distances[i][j].radians();
+    }
+  }
+
+  return List::create(_["x"] = x, _["cell"] = cell, _["distance"] = cellDistance);
+}
+
 // Ops for Ops, Math, Summary generics
 
 // [[Rcpp::export]]
@@ -579,136 +889,50 @@ NumericVector cpp_s2_cell_cummin(NumericVector cellIdVector) {
 
 // [[Rcpp::export]]
 LogicalVector cpp_s2_cell_eq(NumericVector cellIdVector1, NumericVector cellIdVector2) {
-  class Op: public BinaryS2CellOperator<LogicalVector, int> {
-    int processCell(S2CellId cellId1, S2CellId cellId2, R_xlen_t i) {
-      if (R_IsNA(reinterpret_double(cellId1.id())) || 
-            R_IsNA(reinterpret_double(cellId2.id()))) {
-        return NA_LOGICAL;
-      } else {
-        return cellId1.id() == cellId2.id();
-      }
-    }
-  };
-
-  Op op;
-  return op.processVector(cellIdVector1, cellIdVector2);
+  CellCompareKernel<std::equal_to<uint64_t>> kernel{NA_LOGICAL};
+  return processCellKernel(cellIdVector1, cellIdVector2, kernel);
 }
 
 // [[Rcpp::export]]
 LogicalVector cpp_s2_cell_neq(NumericVector cellIdVector1, NumericVector cellIdVector2) {
-  class Op: public BinaryS2CellOperator<LogicalVector, int> {
-    int processCell(S2CellId cellId1, S2CellId cellId2, R_xlen_t i) {
-      if (R_IsNA(reinterpret_double(cellId1.id())) || 
-            R_IsNA(reinterpret_double(cellId2.id()))) {
-        return NA_LOGICAL;
-      } else {
-        return cellId1.id() != cellId2.id();
-      }
-    }
-  };
-
-  Op op;
-  return op.processVector(cellIdVector1, cellIdVector2);
+  CellCompareKernel<std::not_equal_to<uint64_t>> kernel{NA_LOGICAL};
+  return processCellKernel(cellIdVector1, cellIdVector2, kernel);
 }
 
 // [[Rcpp::export]]
 LogicalVector cpp_s2_cell_lt(NumericVector cellIdVector1, NumericVector cellIdVector2) {
-  class Op: public BinaryS2CellOperator<LogicalVector, int> {
-    int processCell(S2CellId cellId1, S2CellId cellId2, R_xlen_t i) {
-      if (R_IsNA(reinterpret_double(cellId1.id())) || 
-            R_IsNA(reinterpret_double(cellId2.id()))) {
-        return NA_LOGICAL;
-      } else {
-        return cellId1.id() < cellId2.id();
-      }
-    }
-  };
-
-  Op op;
-  return op.processVector(cellIdVector1, cellIdVector2);
+  CellCompareKernel<std::less<uint64_t>> kernel{NA_LOGICAL};
+  return processCellKernel(cellIdVector1, cellIdVector2, kernel);
 }
 
 // [[Rcpp::export]]
 LogicalVector cpp_s2_cell_lte(NumericVector cellIdVector1, NumericVector cellIdVector2) {
-  class Op: public BinaryS2CellOperator<LogicalVector, int> {
-    int processCell(S2CellId cellId1, S2CellId cellId2, R_xlen_t i) {
-      if (R_IsNA(reinterpret_double(cellId1.id())) || 
-            R_IsNA(reinterpret_double(cellId2.id()))) {
-        return NA_LOGICAL;
-      } else {
-        return cellId1.id() <= cellId2.id();
-      }
-    }
-  };
-
-  Op op;
-  return op.processVector(cellIdVector1, cellIdVector2);
+  CellCompareKernel<std::less_equal<uint64_t>> kernel{NA_LOGICAL};
+  return processCellKernel(cellIdVector1, cellIdVector2, kernel);
 }
 
 // [[Rcpp::export]]
 LogicalVector cpp_s2_cell_gte(NumericVector cellIdVector1, NumericVector cellIdVector2) {
-  class Op: public BinaryS2CellOperator<LogicalVector, int> {
-    int processCell(S2CellId cellId1, S2CellId cellId2, R_xlen_t i) {
-      if (R_IsNA(reinterpret_double(cellId1.id())) || 
-            R_IsNA(reinterpret_double(cellId2.id()))) {
-        return NA_LOGICAL;
-      } else {
-        return cellId1.id() >= cellId2.id();
-      }
-    }
-  };
-
-  Op op;
-  return op.processVector(cellIdVector1, cellIdVector2);
+  CellCompareKernel<std::greater_equal<uint64_t>> kernel{NA_LOGICAL};
+  return processCellKernel(cellIdVector1, cellIdVector2, kernel);
 }
 
 // [[Rcpp::export]]
 LogicalVector cpp_s2_cell_gt(NumericVector cellIdVector1, NumericVector cellIdVector2) {
-  class Op: public BinaryS2CellOperator<LogicalVector, int> {
-    int processCell(S2CellId cellId1, S2CellId cellId2, R_xlen_t i) {
-      if (R_IsNA(reinterpret_double(cellId1.id())) || 
-            R_IsNA(reinterpret_double(cellId2.id()))) {
-        return NA_LOGICAL;
-      } else {
-        return cellId1.id() > cellId2.id();
-      }
-    }
-  };
-
-  Op op;
-  return op.processVector(cellIdVector1, cellIdVector2);
+  CellCompareKernel<std::greater<uint64_t>> kernel{NA_LOGICAL};
+  return processCellKernel(cellIdVector1, cellIdVector2, kernel);
 }
 
 // [[Rcpp::export]]
 LogicalVector cpp_s2_cell_contains(NumericVector cellIdVector1, NumericVector cellIdVector2) {
-  class Op: public BinaryS2CellOperator<LogicalVector, int> {
-    int processCell(S2CellId cellId1, S2CellId cellId2, R_xlen_t i) {
-      if (cellId1.is_valid() && cellId2.is_valid()) {
-        return cellId1.contains(cellId2);
-      } else {
-        return NA_LOGICAL;
-      }
-    }
-  };
-
-  Op op;
-  return op.processVector(cellIdVector1, cellIdVector2);
+  CellContainsKernel kernel{NA_LOGICAL};
+  return processCellKernel(cellIdVector1, cellIdVector2, kernel);
 }
 
 // [[Rcpp::export]]
 LogicalVector cpp_s2_cell_may_intersect(NumericVector cellIdVector1, NumericVector cellIdVector2) {
-  class Op: public BinaryS2CellOperator<LogicalVector, int> {
-    int processCell(S2CellId cellId1, S2CellId cellId2, R_xlen_t i) {
-      if (cellId1.is_valid() && cellId2.is_valid()) {
-        return S2Cell(cellId1).MayIntersect(S2Cell(cellId2));
-      } else {
-        return NA_LOGICAL;
-      }
-    }
-  };
-
-  Op op;
-  return op.processVector(cellIdVector1, cellIdVector2);
+  CellMayIntersectKernel kernel{NA_LOGICAL};
+  return processCellKernel(cellIdVector1, cellIdVector2, kernel);
 }
 
 // [[Rcpp::export]]
@@ -0,0 +1,85 @@
+
+#include <unordered_set>
+
+#include "s2-feature-index.h"
+
+#include <Rcpp.h>
+using namespace Rcpp;
+
+FeatureIndex* checkFeatureIndex(SEXP index) {
+  FeatureIndex* featureIndexPtr = featureIndex(index);
+  if (featureIndexPtr == nullptr) {
+    stop("`index` must be created by s2_feature_index()");
+  }
+
+  return featureIndexPtr;
+}
+
+// [[Rcpp::export]]
+SEXP cpp_s2_feature_index(int maxEdgesPerCell) {
+  return XPtr<FeatureIndex>(
+    new FeatureIndex(maxEdgesPerCell),
+    true,
+    Rf_install("s2_feature_index")
+  );
+}
+
+// [[Rcpp::export]]
+IntegerVector cpp_s2_feature_index_append(SEXP index, List geog) {
+  FeatureIndex* features = checkFeatureIndex(index);
+  R_xlen_t firstId = features->Append(geog);
+
+  // convert to R index (+1)
+  IntegerVector ids(geog.size());
+  for (R_xlen_t i = 0; i < geog.size(); i++) {
+    ids[i] = firstId + i + 1;
+  }
+
+  return ids;
+}
+
+// [[Rcpp::export]]
+void cpp_s2_feature_index_remove(SEXP index, IntegerVector ids) {
+  FeatureIndex* features = checkFeatureIndex(index);
+
+  // check all ids before removing any of them
+  std::unordered_set<R_xlen_t> featureIds;
+  for (R_xlen_t i = 0; i < ids.size(); i++) {
+    if (IntegerVector::is_na(ids[i])) {
+      stop("Can't remove a missing feature id");
+    }
+
+    R_xlen_t featureId = ids[i] - 1;
+    if (!features->Contains(featureId)) {
+      stop("Feature %d is not in the index", ids[i]);
+    }
+
+    if (!featureIds.insert(featureId).second) {
+      stop("Feature %d can't be removed more than once", ids[i]);
+    }
+  }
+
+  for (R_xlen_t i = 0; i < ids.size(); i++) {
+    features->Remove(ids[i] - 1);
+  }
+}
+
+// [[Rcpp::export]]
+IntegerVector cpp_s2_feature_index_ids(SEXP index) {
+  std::vector<R_xlen_t> featureIds = checkFeatureIndex(index)->FeatureIds();
+  IntegerVector ids(featureIds.size());
+  for (size_t i = 0; i < featureIds.size(); i++) {
+    ids[i] = featureIds[i] + 1;
+  }
+
+  return ids;
+}
+
+// [[Rcpp::export]]
+List cpp_s2_feature_index_info(SEXP index) {
+  FeatureIndex* features = checkFeatureIndex(index);
+  return List::create(
+    _["features"] = static_cast<double>(features->NumFeatures()),
+    _["shapes"] = static_cast<double>(features->NumShapes())
+  );
+}
@@ -0,0 +1,149 @@
+
+#ifndef S2_FEATURE_INDEX_H
+#define S2_FEATURE_INDEX_H
+
+#include <unordered_map>
+#include <vector>
+
+#include "s2/mutable_s2shape_index.h"
+
+#include "geography.h"
+
+#include <Rcpp.h>
+
+// A MutableS2ShapeIndex of features that can be appended and removed after
+// the index is built. The index applies additions and removals
+// incrementally the next time it is queried, so the cost of an update is
+// proportional to the number of edges added or removed rather than the size
+// of the index. Features are identified by (zero-based) ids that are assigned
+// in order as features are appended and are never reused.
+class FeatureIndex {
+public:
+  FeatureIndex(int maxEdgesPerCell) {
+    MutableS2ShapeIndex::Options options;
+    options.set_max_edges_per_cell(maxEdgesPerCell);
+    this->index.Init(options);
+  }
+
+  // Returns the id of the first appended feature. Missing features are
+  // assigned an id but don't add any shapes, so that ids of features appended
+  // together refer to positions in geog.
+  R_xlen_t Append(Rcpp::List geog) {
+    R_xlen_t firstId = this->features.size();
+    for (R_xlen_t i = 0; i < geog.size(); i++) {
+      SEXP item = geog[i];
+      R_xlen_t featureId = this->features.size();
+      this->features.push_back(item);
+      this->featureShapes.push_back(std::vector<int>());
+
+      if (item == R_NilValue) {
+        continue;
+      }
+
+      Rcpp::XPtr<Geography> feature(checkGeographyPointer(item));
+      std::vector<int> shapeIds = feature->BuildShapeIndex(&this->index);
+      for (int shapeId: shapeIds) {
+        this->shapeFeatures[shapeId] = featureId;
+      }
+      this->featureShapes[featureId] = std::move(shapeIds);
+    }
+
+    return firstId;
+  }
+
+  void Remove(R_xlen_t featureId) {
+    if (!this->Contains(featureId)) {
+      Rcpp::stop("Feature %d is not in the index", featureId + 1);
+    }
+
+    for (int shapeId: this->featureShapes[featureId]) {
+      this->index.Release(shapeId);
+      this->shapeFeatures.erase(shapeId);
+    }
+
+    this->featureShapes[featureId].clear();
+    this->features[featureId] = R_NilValue;
+  }
+
+  bool Contains(R_xlen_t featureId) const {
+    return featureId >= 0 &&
+      featureId < static_cast<R_xlen_t>(this->features.size()) &&
+      this->features[featureId] != R_NilValue;
+  }
+
+  // the ids of features that haven't been removed (excluding missing features)
+  std::vector<R_xlen_t> FeatureIds() const {
+    std::vector<R_xlen_t> featureIds;
+    for (size_t i = 0; i < this->features.size(); i++) {
+      if (this->features[i] != R_NilValue) {
+        featureIds.push_back(i);
+      }
+    }
+
+    return featureIds;
+  }
+
+  Geography* Feature(R_xlen_t featureId) {
+    return Rcpp::XPtr<Geography>(this->features[featureId]).get();
+  }
+
+  // Indexed by feature id (nullptr for missing or removed features), for
+  // operators that return a value for every id and run in parallel
+  // (see geographyPointers()).
+  std::vector<Geography*> FeaturePointers() {
+    std::vector<Geography*> pointers(this->features.size(), nullptr);
+    for (size_t i = 0; i < this->features.size(); i++) {
+      if (this->features[i] != R_NilValue) {
+        pointers[i] = this->Feature(i);
+      }
+    }
+
+    return pointers;
+  }
+
+  MutableS2ShapeIndex* Index() {
+    return &this->index;
+  }
+
+  std::unordered_map<int, R_xlen_t>& ShapeFeatures() {
+    return this->shapeFeatures;
+  }
+
+  // the id of the feature from which shapeId came
+  R_xlen_t FeatureId(int shapeId) const {
+    return this->shapeFeatures.at(shapeId);
+  }
+
+  R_xlen_t NumFeatures() const {
+    return this->FeatureIds().size();
+  }
+
+  R_xlen_t NumShapes() const {
+    return this->shapeFeatures.size();
+  }
+
+private:
+  // Shapes in the index point into the geographies they were built from, so
+  // the features must outlive the index (members are destroyed in the
+  // reverse order in which they are declared).
+  std::vector<Rcpp::RObject> features;
+  std::vector<std::vector<int>> featureShapes;
+  std::unordered_map<int, R_xlen_t> shapeFeatures;
+  MutableS2ShapeIndex index;
+};
+
+// Returns nullptr if geog is not a feature index created by s2_feature_index().
+inline FeatureIndex* featureIndex(SEXP geog) {
+  if (TYPEOF(geog) != EXTPTRSXP || R_ExternalPtrTag(geog) != Rf_install("s2_feature_index")) {
+    return nullptr;
+  }
+
+  FeatureIndex* index = static_cast<FeatureIndex*>(R_ExternalPtrAddr(geog));
+  if (index == nullptr) {
+    Rcpp::stop("Feature index is no longer valid (it can't be restored from a saved object)");
+  }
+
+  return index;
+}
+
+#endif
@@ -15,6 +15,9 @@
 #include "polyline-geography.h"
 #include "polygon-geography.h"
 #include "geography-collection.h"
+#include "geography-coding.h"
+#include "s2-parallel.h"
+#include "s2-profile.h"
 
 #include <Rcpp.h>
 using namespace Rcpp;
@@ -32,6 +35,7 @@ List s2_geography_from_wkb(List wkb, bool oriented, bool check) {
 
   while (reader.hasNextFeature()) {
     checkUserInterrupt();
+    Profile::Timer timer(Profile::WKB_IMPORT);
     reader.iterateFeature();
   }
 
@@ -115,6 +119,132 @@ List s2_geography_to_wkb(List s2_geography, int endian) {
   return exporter.output;
 }
 
+// [[Rcpp::export]]
+List s2_geography_serialize(List s2_geography, bool index) {
+  List output(s2_geography.size());
+
+  for (R_xlen_t i = 0; i < s2_geography.size(); i++) {
+    checkUserInterrupt();
+    SEXP item = s2_geography[i];
+    if (item == R_NilValue) {
+      output[i] = R_NilValue;
+      continue;
+    }
+
+    XPtr<Geography> feature(checkGeographyPointer(item));
+    Encoder encoder;
+    GeographyEncoder::Encode(feature.get(), &encoder, index);
+
+    RawVector bytes(encoder.length());
+    memcpy(RAW(bytes), encoder.base(), encoder.length());
+    output[i] = bytes;
+  }
+
+  return output;
+}
+
+// [[Rcpp::export]]
+List s2_geography_unserialize(List serialized, bool decode) {
+  List output(serialized.size());
+
+  for (R_xlen_t i = 0; i < serialized.size(); i++) {
+    checkUserInterrupt();
+    SEXP item = serialized[i];
+    if (item == R_NilValue) {
+      output[i] = R_NilValue;
+      continue;
+    }
+
+    if (TYPEOF(item) != RAWSXP) {
+      stop("Serialized geography at index %d is not a raw vector", i + 1);
+    }
+
+    if (!decode) {
+      // the feature refers to the bytes of item, which the external pointer
+      // keeps alive
+      const char* data = reinterpret_cast<const char*>(RAW(item));
+      std::unique_ptr<EncodedGeography> feature = EncodedGeography::Create(data, Rf_xlength(item));
+      if (!feature) {
+        stop("Can't decode serialized geography at index %d", i + 1);
+      }
+
+      output[i] = XPtr<Geography>(feature.release(), true, R_NilValue, item);
+      continue;
+    }
+
+    Decoder decoder(RAW(item), Rf_xlength(item));
+    std::unique_ptr<Geography> feature = GeographyEncoder::Decode(&decoder);
+    if (!feature || decoder.avail() != 0) {
+      stop("Can't decode serialized geography at index %d", i + 1);
+    }
+
+    output[i] = XPtr<Geography>(feature.release());
+  }
+
+  return output;
+}
+
+// [[Rcpp::export]]
+List cpp_s2_prepare(List geog, int maxEdgesPerCell, int numThreads) {
+  std::vector<Geography*> features = geographyPointers(geog);
+
+  parallelFor(features.size(), [&](R_xlen_t i) {
+    if (features[i] != nullptr) {
+      features[i]->PrepareShapeIndex(maxEdgesPerCell);
+    }
+  }, numThreads, 1);
+
+  return geog;
+}
+
+// [[Rcpp::export]]
+List cpp_s2_memory_usage(List geog) {
+  NumericVector vertices(geog.size());
+  NumericVector internalIndex(geog.size());
+  NumericVector shapeIndex(geog.size());
+  NumericVector coverings(geog.size());
+
+  for (R_xlen_t i = 0; i < geog.size(); i++) {
+    SEXP item = geog[i];
+    if (item == R_NilValue) {
+      vertices[i] = NA_REAL;
+      internalIndex[i] = NA_REAL;
+      shapeIndex[i] = NA_REAL;
+      coverings[i] = NA_REAL;
+    } else {
+      XPtr<Geography> feature(checkGeographyPointer(item));
+      vertices[i] = feature->VertexSpaceUsed();
+      internalIndex[i] = feature->InternalIndexSpaceUsed();
+      shapeIndex[i] = feature->ShapeIndexSpaceUsed();
+      coverings[i] = feature->CoveringSpaceUsed();
+    }
+  }
+
+  return List::create(
+    _["vertices"] = vertices,
+    _["internal_index"] = internalIndex,
+    _["shape_index"] = shapeIndex,
+    _["coverings"] = coverings
+  );
+}
+
+// [[Rcpp::export]]
+List cpp_s2_index_memory_budget() {
+  ShapeIndexBudget& budget = ShapeIndexBudget::Global();
+  return List::create(
+    _["budget"] = static_cast<double>(budget.Budget()),
+    _["used"] = static_cast<double>(budget.TotalBytes())
+  );
+}
+
+// [[Rcpp::export]]
+void cpp_s2_set_index_memory_budget(double bytes) {
+  ShapeIndexBudget& budget = ShapeIndexBudget::Global();
+  budget.SetBudget(static_cast<size_t>(bytes));
+  // no indexes are in use between calls from R
+  budget.Enforce(false);
+}
+
 // [[Rcpp::export]]
 CharacterVector s2_geography_format(List s2_geography, int maxCoords, int precision, bool trim) {
   WKRcppSEXPProvider provider(s2_geography);
@@ -0,0 +1,313 @@
+
+#ifndef S2_INDEX_FILE_H
+#define S2_INDEX_FILE_H
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <process.h>
+#endif
+
+#include "s2/encoded_s2shape_index.h"
+#include "s2/encoded_uint_vector.h"
+#include "s2/mutable_s2shape_index.h"
+#include "s2/s2shape.h"
+#include "s2/third_party/absl/memory/memory.h"
+#include "s2/s2shapeutil_coding.h"
+#include "s2/util/coding/coder.h"
+
+#include <Rcpp.h>
+
+// A read-only index of a geography vector that is written to a file once and
+// opened as an EncodedS2ShapeIndex. The file is memory-mapped (on Windows it
+// is read into memory instead), cells are decoded as they are visited, and
+// shapes are decoded the first time they are needed, so opening a file is
+// nearly instant regardless of its size. Because the mapping is read-only,
+// processes forked after the file is opened share its pages. The layout is:
+//
+// - 8 bytes: "s2index1"
+// - varint64: number of features in the geography vector
+// - EncodedUintVector<uint32>: the feature from which each shape id came
+// - s2shapeutil::CompactEncodeTaggedShapes()
+// - MutableS2ShapeIndex::Encode()
+class ShapeIndexFile {
+public:
+  // shapeFeatures[i] is the (zero-based) feature from which shape id i came
+  static void Write(const std::string& path, MutableS2ShapeIndex* index,
+                    const std::vector<uint32>& shapeFeatures, uint64 numFeatures) {
+    index->ForceBuild();
+
+    Encoder encoder;
+    encoder.Ensure(8 + Varint::kMax64);
+    encoder.putn(magic(), 8);
+    encoder.put_varint64(numFeatures);
+    s2coding::EncodeUintVector<uint32>(shapeFeatures, &encoder);
+    if (!s2shapeutil::CompactEncodeTaggedShapes(*index, &encoder)) {
+      Rcpp::stop("Can't encode shapes for index file");
+    }
+    index->Encode(&encoder);
+
+    // the file is written next to path and renamed over it so that an
+    // existing file is replaced rather than truncated (processes that have
+    // mapped the old file, including this one, keep reading its pages)
+    std::string tempPath = path + ".tmp" + std::to_string(processId());
+    std::ofstream stream(tempPath, std::ios::out | std::ios::binary | std::ios::trunc);
+    stream.write(encoder.base(), encoder.length());
+    stream.close();
+    if (!stream) {
+      std::remove(tempPath.c_str());
+      Rcpp::stop("Can't write index file '%s'", path);
+    }
+
+#ifdef _WIN32
+    // rename() doesn't replace existing files on Windows (where index files
+    // are read into memory rather than mapped)
+    std::remove(path.c_str());
+#endif
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+      std::remove(tempPath.c_str());
+      Rcpp::stop("Can't write index file '%s'", path);
+    }
+  }
+
+  ShapeIndexFile(const std::string& path): file(path) {
+    Decoder decoder(this->file.data, this->file.size);
+    if (decoder.avail() < 8 || memcmp(decoder.ptr(), magic(), 8) != 0) {
+      Rcpp::stop("'%s' is not an index file written by s2_index_write()", path);
+    }
+    decoder.skip(8);
+
+    bool valid = decoder.get_varint64(&this->numFeatures) &&
+      this->numFeatures <= static_cast<uint64>(R_XLEN_T_MAX) &&
+      this->shapeFeatures.Init(&decoder);
+
+    // every shape must come from a feature of the geography vector
+    for (size_t i = 0; valid && i < this->shapeFeatures.size(); i++) {
+      valid = this->shapeFeatures[i] < this->numFeatures;
+    }
+
+    if (valid) {
+      // the shape factory keeps a pointer to the encoded shapes, which
+      // stay valid as long as this->file does
+      s2shapeutil::TaggedShapeFactory shapeFactory =
+        s2shapeutil::LazyDecodeShapeFactory(&decoder);
+      valid = this->index.Init(&decoder, shapeFactory) &&
+        static_cast<size_t>(this->index.num_shape_ids()) == this->shapeFeatures.size();
+    }
+
+    if (!valid) {
+      Rcpp::stop("Can't decode index file '%s'", path);
+    }
+  }
+
+  EncodedS2ShapeIndex* Index() {
+    return &this->index;
+  }
+
+  // the zero-based feature from which shapeId came
+  R_xlen_t FeatureId(int shapeId) const {
+    return this->shapeFeatures[shapeId];
+  }
+
+  // the zero-based feature from which each shape id came
+  const s2coding::EncodedUintVector<uint32>& ShapeFeatures() const {
+    return this->shapeFeatures;
+  }
+
+  R_xlen_t NumFeatures() const {
+    return this->numFeatures;
+  }
+
+  int NumShapes() const {
+    return this->index.num_shape_ids();
+  }
+
+  size_t Size() const {
+    return this->file.size;
+  }
+
+private:
+  static const char* magic() {
+    return "s2index1";
+  }
+
+  static int processId() {
+#ifndef _WIN32
+    return getpid();
+#else
+    return _getpid();
+#endif
+  }
+
+  // The contents of the file, which must outlive everything decoded from it
+  // (members are destroyed in the reverse order in which they are declared)
+  class MappedFile {
+  public:
+    const char* data;
+    size_t size;
+
+    MappedFile(const std::string& path): data(nullptr), size(0) {
+#ifndef _WIN32
+      int fd = ::open(path.c_str(), O_RDONLY);
+      if (fd == -1) {
+        Rcpp::stop("Can't open index file '%s'", path);
+      }
+
+      struct stat info;
+      if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        Rcpp::stop("Can't open index file '%s'", path);
+      }
+
+      void* address = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+      ::close(fd);
+      if (address == MAP_FAILED) {
+        Rcpp::stop("Can't map index file '%s' into memory", path);
+      }
+
+      this->data = static_cast<const char*>(address);
+      this->size = info.st_size;
+#else
+      std::ifstream stream(path, std::ios::in | std::ios::binary | std::ios::ate);
+      if (!stream) {
+        Rcpp::stop("Can't open index file '%s'", path);
+      }
+
+      this->buffer.resize(stream.tellg());
+      stream.seekg(0);
+      stream.read(this->buffer.data(), this->buffer.size());
+      if (!stream) {
+        Rcpp::stop("Can't read index file '%s'", path);
+      }
+
+      this->data = this->buffer.data();
+      this->size = this->buffer.size();
+#endif
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+      if (this->data != nullptr) {
+        munmap(const_cast<char*>(this->data), this->size);
+      }
+#endif
+    }
+
+  private:
+    std::vector<char> buffer;
+  };
+
+  MappedFile file;
+  uint64 numFeatures;
+  s2coding::EncodedUintVector<uint32> shapeFeatures;
+  EncodedS2ShapeIndex index;
+};
+
+// Shape indexes of individual features of an index file, used to compute
+// exact predicates and distances for features found by searching the
+// file's index. Each index is built the first time it is needed (which may
+// happen on more than one thread at once) from the shapes decoded by the
+// file's index, which owns them, so a ShapeIndexFileFeatures must not
+// outlive the file.
+class ShapeIndexFileFeatures {
+public:
+  ShapeIndexFileFeatures(ShapeIndexFile* file): file(file) {
+    for (int shapeId = 0; shapeId < file->NumShapes(); shapeId++) {
+      this->featureShapes[file->FeatureId(shapeId)].push_back(shapeId);
+    }
+  }
+
+  S2ShapeIndex* ShapeIndex(R_xlen_t featureId) {
+    LazyIndex* lazyIndex;
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      std::unique_ptr<LazyIndex>& item = this->indexes[featureId];
+      if (!item) {
+        item = absl::make_unique<LazyIndex>();
+      }
+
+      lazyIndex = item.get();
+    }
+
+    if (!lazyIndex->isBuilt.load(std::memory_order_acquire)) {
+      std::lock_guard<std::mutex> lock(lazyIndex->mutex);
+      if (!lazyIndex->isBuilt.load(std::memory_order_relaxed)) {
+        // features without shapes (e.g., missing features) aren't in
+        // featureShapes and have an empty index
+        auto shapeIds = this->featureShapes.find(featureId);
+        if (shapeIds != this->featureShapes.end()) {
+          for (int shapeId: shapeIds->second) {
+            S2Shape* shape = this->file->Index()->shape(shapeId);
+            if (shape != nullptr) {
+              lazyIndex->index.Add(absl::make_unique<WrappedShape>(shape));
+            }
+          }
+        }
+
+        lazyIndex->index.ForceBuild();
+        lazyIndex->isBuilt.store(true, std::memory_order_release);
+      }
+    }
+
+    return &lazyIndex->index;
+  }
+
+private:
+  // An S2Shape that refers to a shape owned by the file's index
+  class WrappedShape: public S2Shape {
+  public:
+    WrappedShape(S2Shape* shape): shape(shape) {}
+    int num_edges() const { return this->shape->num_edges(); }
+    Edge edge(int edgeId) const { return this->shape->edge(edgeId); }
+    int dimension() const { return this->shape->dimension(); }
+    ReferencePoint GetReferencePoint() const { return this->shape->GetReferencePoint(); }
+    int num_chains() const { return this->shape->num_chains(); }
+    Chain chain(int chainId) const { return this->shape->chain(chainId); }
+    Edge chain_edge(int chainId, int offset) const { return this->shape->chain_edge(chainId, offset); }
+    ChainPosition chain_position(int edgeId) const { return this->shape->chain_position(edgeId); }
+
+  private:
+    S2Shape* shape;
+  };
+
+  struct LazyIndex {
+    std::atomic<bool> isBuilt{false};
+    std::mutex mutex;
+    MutableS2ShapeIndex index;
+  };
+
+  ShapeIndexFile* file;
+  // only features with at least one shape are included
+  std::unordered_map<R_xlen_t, std::vector<int>> featureShapes;
+  std::unordered_map<R_xlen_t, std::unique_ptr<LazyIndex>> indexes;
+  std::mutex mutex;
+};
+
+// Returns nullptr if geog is not an index opened by s2_index_read().
+inline ShapeIndexFile* shapeIndexFile(SEXP geog) {
+  if (TYPEOF(geog) != EXTPTRSXP || R_ExternalPtrTag(geog) != Rf_install("s2_index_file")) {
+    return nullptr;
+  }
+
+  ShapeIndexFile* file = static_cast<ShapeIndexFile*>(R_ExternalPtrAddr(geog));
+  if (file == nullptr) {
+    Rcpp::stop("Index file is no longer open (use s2_index_read() to reopen it)");
+  }
+
+  return file;
+}
+
+#endif
@@ -0,0 +1,98 @@
+
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "s2/s2region_term_indexer.h"
+
+#include "geography.h"
+#include "s2-parallel.h"
+
+#include <Rcpp.h>
+using namespace Rcpp;
+
+// [[Rcpp::export]]
+List cpp_s2_region_terms(List geog, std::string prefix, int minLevel, int maxLevel,
+                         int levelMod, int maxCells, bool pointsOnly,
+                         bool optimizeForSpace, bool query, int numThreads) {
+  S2RegionTermIndexer::Options options;
+  options.set_min_level(minLevel);
+  options.set_max_level(maxLevel);
+  options.set_level_mod(levelMod);
+  options.set_max_cells(maxCells);
+  options.set_index_contains_points_only(pointsOnly);
+  options.set_optimize_for_space(optimizeForSpace);
+
+  // terms are generated in parallel but can only be converted to
+  // R objects on the main thread
+  std::vector<Geography*> features = geographyPointers(geog);
+
+  // S2RegionTermIndexer can only generate index terms for points when
+  // index_contains_points_only is set (and aborts the process otherwise)
+  if (pointsOnly && !query) {
+    for (R_xlen_t i = 0; i < (R_xlen_t) features.size(); i++) {
+      if (features[i] != nullptr && !features[i]->IsEmpty() &&
+          features[i]->GeographyType() != Geography::Type::GEOGRAPHY_POINT) {
+        Rcpp::stop("Can't generate index terms for non-point feature %d with points_only = TRUE", i + 1);
+      }
+    }
+  }
+
+  std::vector<std::vector<std::string>> terms(features.size());
+  parallelFor(features.size(), [&](R_xlen_t i) {
+    if (features[i] == nullptr) {
+      return;
+    }
+
+    // the indexer keeps a coverer whose state changes with each region
+    S2RegionTermIndexer indexer(options);
+
+    // single points have their own (faster) methods (encoded features
+    // only need to be decoded to use them if they are points)
+    DecodedGeography feature(
+      features[i],
+      features[i]->GeographyType() == Geography::Type::GEOGRAPHY_POINT
+    );
+    const std::vector<S2Point>* points = feature->Point();
+    if (pointsOnly && !query) {
+      // multipoints are indexed as the union of the terms of each point
+      // (empty features have no terms)
+      if (points == nullptr) {
+        return;
+      }
+
+      std::unordered_set<std::string> seen;
+      for (const S2Point& point: *points) {
+        for (std::string& term: indexer.GetIndexTerms(point, prefix)) {
+          if (seen.insert(term).second) {
+            terms[i].push_back(std::move(term));
+          }
+        }
+      }
+    } else if (points != nullptr && points->size() == 1) {
+      if (query) {
+        terms[i] = indexer.GetQueryTerms(points->at(0), prefix);
+      } else {
+        terms[i] = indexer.GetIndexTerms(points->at(0), prefix);
+      }
+    } else {
+      S2ShapeIndexRegion<S2ShapeIndex> region = features[i]->ShapeIndexRegion();
+      if (query) {
+        terms[i] = indexer.GetQueryTerms(region, prefix);
+      } else {
+        terms[i] = indexer.GetIndexTerms(region, prefix);
+      }
+    }
+  }, numThreads, 1);
+
+  List output(features.size());
+  for (R_xlen_t i = 0; i < output.size(); i++) {
+    if (features[i] == nullptr) {
+      output[i] = R_NilValue;
+    } else {
+      output[i] = wrap(terms[i]);
+    }
+  }
+
+  return output;
+}
@@ -0,0 +1,54 @@
+
+#include "s2/mutable_s2shape_index.h"
+
+#include "geography.h"
+#include "s2-index-file.h"
+
+#include <Rcpp.h>
+using namespace Rcpp;
+
+// [[Rcpp::export]]
+void cpp_s2_index_write(List geog, std::string file, int maxEdgesPerCell, int numThreads) {
+  MutableS2ShapeIndex::Options indexOptions;
+  indexOptions.set_max_edges_per_cell(maxEdgesPerCell);
+  indexOptions.set_num_threads(numThreads);
+  MutableS2ShapeIndex index(indexOptions);
+
+  // missing features don't add any shapes but still count towards
+  // the number of features so that indices refer to the original vector
+  std::vector<uint32> shapeFeatures;
+  for (R_xlen_t i = 0; i < geog.size(); i++) {
+    checkUserInterrupt();
+    SEXP item = geog[i];
+    if (item == R_NilValue) {
+      continue;
+    }
+
+    XPtr<Geography> feature(checkGeographyPointer(item));
+    std::vector<int> shapeIds = feature->BuildShapeIndex(&index);
+    for (int shapeId: shapeIds) {
+      if (static_cast<size_t>(shapeId) >= shapeFeatures.size()) {
+        shapeFeatures.resize(shapeId + 1);
+      }
+
+      shapeFeatures[shapeId] = i;
+    }
+  }
+
+  ShapeIndexFile::Write(file, &index, shapeFeatures, geog.size());
+}
+
+// [[Rcpp::export]]
+SEXP cpp_s2_index_read(std::string file) {
+  return XPtr<ShapeIndexFile>(new ShapeIndexFile(file), true, Rf_install("s2_index_file"));
+}
+
+// [[Rcpp::export]]
+List cpp_s2_index_info(SEXP index) {
+  ShapeIndexFile* file = shapeIndexFile(index);
+  return List::create(
+    _["features"] = static_cast<double>(file->NumFeatures()),
+    _["shapes"] = file->NumShapes(),
+    _["bytes"] = static_cast<double>(file->Size())
+  );
+}
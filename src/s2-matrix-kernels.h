@@ -0,0 +1,73 @@
+
+#ifndef S2_MATRIX_KERNELS_H
+#define S2_MATRIX_KERNELS_H
+
+#include <vector>
+
+#include "s2/s1chord_angle.h"
+#include "s2/s2cell_union.h"
+#include "s2/s2closest_edge_query.h"
+#include "s2/s2furthest_edge_query.h"
+#include "s2/s2shape_index.h"
+
+// The inner loops of the matrix functions in s2-matrix.cpp, which are also
+// used by the benchmarks in bench/ (so they can't use R or Rcpp).
+
+// Inserts the feature of every shape in index that may intersect covering
+// into candidates, where source[shapeId] is the feature from which shapeId
+// came. IndexType is MutableS2ShapeIndex or EncodedS2ShapeIndex (whose
+// iterators are used directly to avoid virtual calls), and interrupt() is
+// called for each index cell visited below a cell of the covering, which
+// may be many.
+template<class IndexType, class SourceType, class Candidates, class Interrupt>
+void findIndexCandidates(const S2CellUnion& covering, const IndexType* index,
+                         SourceType& source, Candidates* candidates,
+                         Interrupt interrupt) {
+  typename IndexType::Iterator indexIterator(index);
+
+  for (S2CellId featureCellId: covering) {
+    S2ShapeIndex::CellRelation relation = indexIterator.Locate(featureCellId);
+
+    if (relation == S2ShapeIndex::CellRelation::INDEXED) {
+      // the index has this cell in common with the covering, so all of the
+      // shapes it contains are candidates
+      const S2ShapeIndexCell& cell = indexIterator.cell();
+      for (int k = 0; k < cell.num_clipped(); k++) {
+        candidates->insert(source[cell.clipped(k).shape_id()]);
+      }
+
+    } else if (relation == S2ShapeIndex::CellRelation::SUBDIVIDED) {
+      // the index has children of this cell (at which indexIterator is now
+      // positioned), which are visited in order until the iterator leaves
+      // the cell (the same order as a normalized S2CellUnion)
+      while (!indexIterator.done() && featureCellId.contains(indexIterator.id())) {
+        interrupt();
+
+        const S2ShapeIndexCell& cell = indexIterator.cell();
+        for (int k = 0; k < cell.num_clipped(); k++) {
+          candidates->insert(source[cell.clipped(k).shape_id()]);
+        }
+
+        indexIterator.Next();
+      }
+    }
+
+    // else: relation == S2ShapeIndex::CellRelation::DISJOINT (do nothing)
+  }
+}
+
+// The distance between the feature indexed by the query and the feature in
+// index2, using a query that is reused for each feature in a row of a
+// distance matrix. The closest distance is Infinity() and the furthest
+// distance is Negative() if either feature is empty.
+inline S1ChordAngle edgeQueryDistance(S2ClosestEdgeQuery& query, S2ShapeIndex* index2) {
+  S2ClosestEdgeQuery::ShapeIndexTarget target(index2);
+  return query.FindClosestEdge(&target).distance();
+}
+
+inline S1ChordAngle edgeQueryDistance(S2FurthestEdgeQuery& query, S2ShapeIndex* index2) {
+  S2FurthestEdgeQuery::ShapeIndexTarget target(index2);
+  return query.FindFurthestEdge(&target).distance();
+}
+
+#endif
@@ -1,4 +1,7 @@
 
+#include <climits>
+#include <cstdint>
+#include <limits>
 #include <unordered_map>
 #include <unordered_set>
 #include <algorithm>
@@ -6,10 +9,18 @@
 #include "s2/s2boolean_operation.h"
 #include "s2/s2closest_edge_query.h"
 #include "s2/s2furthest_edge_query.h"
+#include "s2/s2shape_index_buffered_region.h"
 #include "s2/s2shape_index_region.h"
 
 #include "geography-operator.h"
+#include "geography-relate.h"
+#include "s2-cell-index-join.h"
+#include "s2-feature-index.h"
+#include "s2-index-file.h"
+#include "s2-matrix-kernels.h"
+#include "s2-parallel.h"
 #include "s2-options.h"
+#include "s2-profile.h"
 
 #include <Rcpp.h>
 using namespace Rcpp;
@@ -27,7 +38,7 @@ std::unordered_map<int, R_xlen_t> buildSourcedIndex(List geog, MutableS2ShapeInd
     if (item2 == R_NilValue) {
       Rcpp::stop("Missing `y` not allowed in binary indexed operators()");
     } else {
-      Rcpp::XPtr<Geography> feature2(item2);
+      Rcpp::XPtr<Geography> feature2(checkGeographyPointer(item2));
       shapeIds = feature2->BuildShapeIndex(index);
       for (size_t k = 0; k < shapeIds.size(); k ++) {
         indexSource[shapeIds[k]] = j;
@@ -38,59 +49,50 @@ std::unordered_map<int, R_xlen_t> buildSourcedIndex(List geog, MutableS2ShapeInd
   return indexSource;
 }
 
-std::unordered_set<R_xlen_t> findPossibleIntersections(const S2Region& region, 
-                                                       const MutableS2ShapeIndex* index,
-                                                       std::unordered_map<int, R_xlen_t>& source,
-                                                       int maxRegionCells) {
-  
-  std::unordered_set<R_xlen_t> mightIntersectIndices;
-  MutableS2ShapeIndex::Iterator indexIterator(index);
-
-  // generate a small covering of the region
-  S2RegionCoverer coverer;
-  coverer.mutable_options()->set_max_cells(maxRegionCells);
-  S2CellUnion covering = coverer.GetCovering(region);
-
-  // iterate over cells in the featureIndex
-  for (S2CellId featureCellId: covering) {
-    S2ShapeIndex::CellRelation relation = indexIterator.Locate(featureCellId);
-
-    if (relation == S2ShapeIndex::CellRelation::INDEXED) {
-      // we're in luck! these indexes have this cell in common
-      // add all the features it contains as possible intersectors for featureIndex
-      const S2ShapeIndexCell& cell = indexIterator.cell();
-      for (int k = 0; k < cell.num_clipped(); k++) {
-        int shapeId = cell.clipped(k).shape_id();
-        mightIntersectIndices.insert(source[shapeId]);
-      }
-    
-    } else if(relation  == S2ShapeIndex::CellRelation::SUBDIVIDED) {
-      // promising! the geog2 index has a child cell of it.id()
-      // (at which indexIterator is now positioned)
-      // keep iterating until the iterator is done OR we're no longer at a child cell of
-      // it.id(). The ordering of the iterator isn't guaranteed anywhere in the documentation;
-      // however, this ordering would be consistent with that of a Normalized
-      // S2CellUnion.
-      while (!indexIterator.done() && featureCellId.contains(indexIterator.id())) {
-        // potentially many cells in the indexIterator, so let the user cancel if this is
-        // running too long
-        checkUserInterrupt();
-
-        // add all the features the child cell contains as possible intersectors for featureIndex
-        const S2ShapeIndexCell& cell = indexIterator.cell();
-        for (int k = 0; k < cell.num_clipped(); k++) {
-          int shapeId = cell.clipped(k).shape_id();
-          mightIntersectIndices.insert(source[shapeId]);
-        }
+// The covering cached with feature by s2_covering(cache = TRUE) that can
+// be used instead of a covering with maxCells cells: any cached covering
+// if anyCachedCovering is true, or only one that was computed with maxCells
+// (and the default levels) otherwise. Returns nullptr if there is none.
+std::shared_ptr<const S2CellUnion> cachedFeatureCovering(Geography* feature, int maxCells,
+                                                         bool anyCachedCovering) {
+  if (anyCachedCovering) {
+    return feature->CachedCovering();
+  }
 
-        // go to the next cell in the index
-        indexIterator.Next();
-      }
-    }
+  S2RegionCoverer::Options options;
+  options.set_max_cells(maxCells);
+  return feature->CachedCovering(options);
+}
 
-    // else: relation == S2ShapeIndex::CellRelation::DISJOINT (do nothing)
+// A covering of feature used to find candidates in another index: the
+// cached covering from cachedFeatureCovering() if there is one, or a
+// small covering with maxCells cells
+std::shared_ptr<const S2CellUnion> featureCovering(Geography* feature, int maxCells,
+                                                   bool anyCachedCovering = true) {
+  std::shared_ptr<const S2CellUnion> cached = cachedFeatureCovering(feature, maxCells, anyCachedCovering);
+  if (cached) {
+    return cached;
   }
 
+  S2RegionCoverer coverer;
+  coverer.mutable_options()->set_max_cells(maxCells);
+  return std::make_shared<const S2CellUnion>(coverer.GetCovering(feature->ShapeIndexRegion()));
+}
+
+// The features in index (a MutableS2ShapeIndex or, for an index opened by
+// s2_index_read(), an EncodedS2ShapeIndex) that might intersect covering,
+// where source[shapeId] is the feature from which shapeId came
+template<class IndexType, class SourceType>
+std::unordered_set<R_xlen_t> findPossibleIntersections(const S2CellUnion& covering,
+                                                       const IndexType* index,
+                                                       SourceType& source) {
+  std::unordered_set<R_xlen_t> mightIntersectIndices;
+  // potentially many cells in the index, so let the user cancel if this is
+  // running too long
+  findIndexCandidates(covering, index, source, &mightIntersectIndices, []() {
+    checkUserInterrupt();
+  });
+
   return mightIntersectIndices;
 }
 
@@ -113,65 +115,113 @@ public:
     MutableS2ShapeIndex::Options indexOptions;
     indexOptions.set_max_edges_per_cell(maxEdgesPerCell);
     this->geog2Index = absl::make_unique<MutableS2ShapeIndex>(indexOptions);
+
+    Profile::Timer timer(Profile::INDEX_BUILD);
     this->geog2IndexSource = buildSourcedIndex(geog2, this->geog2Index.get());
+    this->geog2Index->ForceBuild();
+  }
+
+  // Like buildIndex(), except geog2 can also be an index opened by s2_index_read()
+  // or a feature index created by s2_feature_index(). This is only suitable for
+  // operators that query the combined index using queryIndex() and featureId()
+  // (i.e., that don't use individual features of geog2).
+  void buildOrOpenIndex(SEXP geog2) {
+    this->geog2File = shapeIndexFile(geog2);
+    this->geog2Features = featureIndex(geog2);
+    if (this->geog2File == nullptr && this->geog2Features == nullptr) {
+      this->buildIndex(geog2);
+    }
+  }
+
+  S2ShapeIndex* queryIndex() {
+    if (this->geog2File != nullptr) {
+      return this->geog2File->Index();
+    } else if (this->geog2Features != nullptr) {
+      return this->geog2Features->Index();
+    } else {
+      return this->geog2Index.get();
+    }
+  }
+
+  // the (zero-based) feature in geog2 from which shapeId came
+  R_xlen_t featureId(int shapeId) {
+    if (this->geog2File != nullptr) {
+      return this->geog2File->FeatureId(shapeId);
+    } else if (this->geog2Features != nullptr) {
+      return this->geog2Features->FeatureId(shapeId);
+    } else {
+      return this->geog2IndexSource[shapeId];
+    }
   }
+
+protected:
+  FeatureIndex* geog2Features = nullptr;
+  ShapeIndexFile* geog2File = nullptr;
 };
 
 // -------- closest/farthest feature ----------
 
 // [[Rcpp::export]]
-IntegerVector cpp_s2_closest_feature(List geog1, List geog2) {
+IntegerVector cpp_s2_closest_feature(List geog1, SEXP geog2, double maxError) {
 
   class Op: public IndexedBinaryGeographyOperator<IntegerVector, int> {
   public:
+    S1ChordAngle maxError;
+
     int processFeature(Rcpp::XPtr<Geography> feature, R_xlen_t i) {
-      S2ClosestEdgeQuery query(this->geog2Index.get());
+      S2ClosestEdgeQuery query(this->queryIndex());
+      query.mutable_options()->set_max_error(this->maxError);
       S2ClosestEdgeQuery::ShapeIndexTarget target(feature->ShapeIndex());
       const auto& result = query.FindClosestEdge(&target);
       if (result.is_empty()) {
         return NA_INTEGER;
       } else {
         // convert to R index (+1)
-        return this->geog2IndexSource[result.shape_id()] + 1;
+        return this->featureId(result.shape_id()) + 1;
       }
     }
   };
 
   Op op;
-  op.buildIndex(geog2);
+  op.maxError = S1ChordAngle::Radians(maxError);
+  op.buildOrOpenIndex(geog2);
   return op.processVector(geog1);
 }
 
 // [[Rcpp::export]]
-IntegerVector cpp_s2_farthest_feature(List geog1, List geog2) {
+IntegerVector cpp_s2_farthest_feature(List geog1, SEXP geog2, double maxError) {
 
   class Op: public IndexedBinaryGeographyOperator<IntegerVector, int> {
   public:
+    S1ChordAngle maxError;
+
     int processFeature(Rcpp::XPtr<Geography> feature, R_xlen_t i) {
-      S2FurthestEdgeQuery query(this->geog2Index.get());
+      S2FurthestEdgeQuery query(this->queryIndex());
+      query.mutable_options()->set_max_error(this->maxError);
       S2FurthestEdgeQuery::ShapeIndexTarget target(feature->ShapeIndex());
       const auto& result = query.FindFurthestEdge(&target);
       if (result.is_empty()) {
         return NA_INTEGER;
       } else {
         // convert to R index (+1)
-        return this->geog2IndexSource[result.shape_id()] + 1;
+        return this->featureId(result.shape_id()) + 1;
       }
     }
   };
 
   Op op;
-  op.buildIndex(geog2);
+  op.maxError = S1ChordAngle::Radians(maxError);
+  op.buildOrOpenIndex(geog2);
   return op.processVector(geog1);
 }
 
 // [[Rcpp::export]]
-List cpp_s2_closest_edges(List geog1, List geog2, int n, double min_distance) {
+List cpp_s2_closest_edges(List geog1, SEXP geog2, int n, double min_distance) {
 
   class Op: public IndexedBinaryGeographyOperator<List, IntegerVector> {
   public:
     IntegerVector processFeature(Rcpp::XPtr<Geography> feature, R_xlen_t i) {
-      S2ClosestEdgeQuery query(this->geog2Index.get());
+      S2ClosestEdgeQuery query(this->queryIndex());
       query.mutable_options()->set_max_results(n);
       S2ClosestEdgeQuery::ShapeIndexTarget target(feature->ShapeIndex());
       const auto& result = query.FindClosestEdges(&target);
@@ -180,7 +230,7 @@ List cpp_s2_closest_edges(List geog1, List geog2, int n, double min_distance) {
       std::unordered_set<int> features;
       for (S2ClosestEdgeQuery::Result res : result) {
         if (res.distance().radians() > this->min_distance) {
-          features.insert(this->geog2IndexSource[res.shape_id()] + 1);
+          features.insert(this->featureId(res.shape_id()) + 1);
         }
       }
 
@@ -194,10 +244,108 @@ List cpp_s2_closest_edges(List geog1, List geog2, int n, double min_distance) {
   Op op;
   op.n = n;
   op.min_distance = min_distance;
-  op.buildIndex(geog2);
+  op.buildOrOpenIndex(geog2);
   return op.processVector(geog1);
 }
 
+// [[Rcpp::export]]
+List cpp_s2_knn(List geog1, SEXP geog2, int k, double maxDistance, int numThreads) {
+  MutableS2ShapeIndex::Options indexOptions;
+  indexOptions.set_num_threads(numThreads);
+  MutableS2ShapeIndex geog2Index(indexOptions);
+  std::unordered_map<int, R_xlen_t> geog2IndexSource;
+  ShapeIndexFile* geog2File = shapeIndexFile(geog2);
+  FeatureIndex* geog2Features = featureIndex(geog2);
+  S2ShapeIndex* index = &geog2Index;
+  if (geog2File != nullptr) {
+    index = geog2File->Index();
+  } else if (geog2Features != nullptr) {
+    geog2Features->Index()->ForceBuild();
+    index = geog2Features->Index();
+  } else {
+    geog2IndexSource = buildSourcedIndex(geog2, &geog2Index);
+    geog2Index.ForceBuild();
+  }
+
+  std::vector<Geography*> features = geographyPointers(geog1);
+
+  // S2ClosestEdgeQuery returns edges, several of which may come from the
+  // same feature. Results are sorted by distance, so the nearest k features
+  // are the first k distinct features; if there aren't k distinct features
+  // in the results, the query is repeated with more results.
+  std::vector<std::vector<std::pair<R_xlen_t, double>>> neighbours(geog1.size());
+
+  parallelForRows(geog1.size(), [&](R_xlen_t i) {
+    if (features[i] == nullptr) {
+      return;
+    }
+
+    S2ClosestEdgeQuery query(index);
+    if (R_FINITE(maxDistance)) {
+      query.mutable_options()->set_inclusive_max_distance(S1ChordAngle::Radians(maxDistance));
+    }
+
+    S2ClosestEdgeQuery::ShapeIndexTarget target(features[i]->ShapeIndex());
+    std::vector<std::pair<R_xlen_t, double>>& result = neighbours[i];
+    std::unordered_set<R_xlen_t> seen;
+
+    // max_results is an int, so stop growing it once it reaches INT_MAX
+    const int64_t maxResultsLimit = std::numeric_limits<int>::max();
+    for (int64_t maxResults = k; true; maxResults = std::min(maxResults * 4, maxResultsLimit)) {
+      result.clear();
+      seen.clear();
+
+      query.mutable_options()->set_max_results(static_cast<int>(maxResults));
+      const auto& edges = query.FindClosestEdges(&target);
+
+      for (const S2ClosestEdgeQuery::Result& edge: edges) {
+        R_xlen_t j;
+        if (geog2File != nullptr) {
+          j = geog2File->FeatureId(edge.shape_id());
+        } else if (geog2Features != nullptr) {
+          j = geog2Features->FeatureId(edge.shape_id());
+        } else {
+          j = geog2IndexSource.at(edge.shape_id());
+        }
+
+        if (seen.insert(j).second) {
+          result.push_back(std::pair<R_xlen_t, double>(j, edge.distance().radians()));
+          if (result.size() == static_cast<size_t>(k)) {
+            break;
+          }
+        }
+      }
+
+      if (result.size() == static_cast<size_t>(k) ||
+          edges.size() < static_cast<size_t>(maxResults) ||
+          maxResults == maxResultsLimit) {
+        break;
+      }
+    }
+  }, numThreads);
+
+  R_xlen_t size = 0;
+  for (const auto& result: neighbours) {
+    size += result.size();
+  }
+
+  IntegerVector x(size);
+  IntegerVector y(size);
+  NumericVector distance(size);
+  R_xlen_t row = 0;
+  for (R_xlen_t i = 0; i < geog1.size(); i++) {
+    for (const auto& neighbour: neighbours[i]) {
+      // convert to R index (+1)
+      x[row] = i + 1;
+      y[row] = neighbour.first + 1;
+      distance[row] = neighbour.second;
+      row++;
+    }
+  }
+
+  return List::create(_["x"] = x, _["y"] = y, _["distance"] = distance);
+}
+
 // ----------- indexed binary predicate operators -----------
 
 class IndexedMatrixPredicateOperator: public IndexedBinaryGeographyOperator<List, IntegerVector> {
@@ -205,31 +353,159 @@ public:
   // a max_cells value of 8 was suggested in the S2RegionCoverer docs as a
   // reasonable approximation of a geometry, although benchmarking seems to indicate that
   // increasing this number above 4 actually decreasses performance (using a value
-  // of 1 dramatically decreases performance)
-  IndexedMatrixPredicateOperator(List s2options, int maxFeatureCells = 4):
-    maxFeatureCells(maxFeatureCells) {
+  // of 1 dramatically decreases performance). A negative maxFeatureCells uses
+  // the covering cached by s2_covering() whatever its options and a 4-cell
+  // covering otherwise; otherwise only coverings with maxFeatureCells cells
+  // are used, cached or not.
+  IndexedMatrixPredicateOperator(List s2options, int maxFeatureCells = -1) {
     GeographyOperationOptions options(s2options);
     this->options = options.booleanOperationOptions();
+    this->anyCachedCovering = maxFeatureCells < 0;
+    this->maxFeatureCells = this->anyCachedCovering ? 4 : maxFeatureCells;
   }
 
   // See IndexedBinaryGeographyOperator::buildIndex() for why 50 is the default value
-  // for maxEdgesPerCell
-  void buildIndex(List geog2, int maxEdgesPerCell = 50) {
+  // for maxEdgesPerCell (used when maxEdgesPerCell is negative). Because
+  // candidates found by joinCoverings() don't depend on an index of geog2, the
+  // index is always built when maxEdgesPerCell is given. geog2 can also be a
+  // feature index created by s2_feature_index(), whose index is used as is
+  // (maxEdgesPerCell is ignored) and whose feature ids are returned instead of
+  // indices into geog2. geog2 can also be an index opened by s2_index_read(),
+  // in which case candidates are found by searching the file's index and
+  // refined using indexes of the candidates' decoded shapes.
+  void buildIndex(SEXP geog2, int maxEdgesPerCell = -1) {
+    this->geog2Features = featureIndex(geog2);
+    this->geog2File = shapeIndexFile(geog2);
+    if (this->geog2Features != nullptr) {
+      return;
+    } else if (this->geog2File != nullptr) {
+      this->geog2FileFeatures = absl::make_unique<ShapeIndexFileFeatures>(this->geog2File);
+      return;
+    }
+
+    // the index for geog2 is built by processVector() because it isn't
+    // needed if candidates can be found by joinCoverings()
     this->geog2  = geog2;
-    IndexedBinaryGeographyOperator<List, IntegerVector>::buildIndex(geog2, maxEdgesPerCell);
+    this->canJoinCoverings = maxEdgesPerCell < 0;
+    this->maxEdgesPerCell = this->canJoinCoverings ? 50 : maxEdgesPerCell;
+  }
+
+  List processVector(List geog1) {
+    if (this->geog2Features == nullptr && this->geog2File == nullptr) {
+      Profile::Timer searchTimer(Profile::CANDIDATE_SEARCH);
+      this->useCoveringCandidates = this->canJoinCoverings && this->joinCoverings(geog1);
+      searchTimer.Stop();
+
+      if (!this->useCoveringCandidates) {
+        IndexedBinaryGeographyOperator<List, IntegerVector>::buildIndex(this->geog2, this->maxEdgesPerCell);
+      }
+    }
+
+    return IndexedBinaryGeographyOperator<List, IntegerVector>::processVector(geog1);
+  }
+
+  // When every feature in geog1 and geog2 has a covering cached by
+  // s2_covering(cache = TRUE) that can be used (see cachedFeatureCovering()),
+  // candidates for all features in geog1 are found at once by joining the
+  // coverings in two S2CellIndexes, which is faster than building a shape
+  // index for a large geog2 and searching it once for each feature in a
+  // large geog1. Returns false (and does nothing) if a covering is missing.
+  bool joinCoverings(List geog1) {
+    if (geog1.size() == 0 || this->geog2.size() == 0 ||
+        geog1.size() > INT_MAX || this->geog2.size() > INT_MAX) {
+      return false;
+    }
+
+    std::vector<Geography*> features1 = geographyPointers(geog1);
+    std::vector<Geography*> features2 = geographyPointers(this->geog2);
+    std::vector<std::shared_ptr<const S2CellUnion>> coverings1(features1.size());
+    std::vector<std::shared_ptr<const S2CellUnion>> coverings2(features2.size());
+
+    for (size_t i = 0; i < features1.size(); i++) {
+      // missing features in geog1 are skipped by processVector()
+      if (features1[i] == nullptr) {
+        continue;
+      }
+
+      coverings1[i] = cachedFeatureCovering(features1[i], this->maxFeatureCells, this->anyCachedCovering);
+      if (!coverings1[i]) {
+        return false;
+      }
+    }
+
+    for (size_t j = 0; j < features2.size(); j++) {
+      // missing features in geog2 are an error when the index is built
+      if (features2[j] == nullptr) {
+        return false;
+      }
+
+      coverings2[j] = cachedFeatureCovering(features2[j], this->maxFeatureCells, this->anyCachedCovering);
+      if (!coverings2[j]) {
+        return false;
+      }
+    }
+
+    S2CellIndex index1;
+    for (size_t i = 0; i < coverings1.size(); i++) {
+      if (coverings1[i]) {
+        index1.Add(*coverings1[i], i);
+      }
+    }
+
+    S2CellIndex index2;
+    for (size_t j = 0; j < coverings2.size(); j++) {
+      index2.Add(*coverings2[j], j);
+    }
+
+    index1.Build();
+    index2.Build();
+    this->coveringCandidates.clear();
+    this->coveringCandidates.resize(features1.size());
+    joinCellIndexes(index1, index2, &this->coveringCandidates);
+    return true;
   }
 
   IntegerVector processFeature(Rcpp::XPtr<Geography> feature, R_xlen_t i) {
     S2ShapeIndex* index1 = feature->ShapeIndex();
-    S2ShapeIndexRegion<S2ShapeIndex> region = MakeS2ShapeIndexRegion(index1);
 
     // build a list of candidate feature indices
-    std::unordered_set<R_xlen_t> mightIntersectIndices = findPossibleIntersections(
-      region,
-      this->geog2Index.get(),
-      this->geog2IndexSource,
-      this->maxFeatureCells
-    );
+    std::vector<R_xlen_t> mightIntersectIndices;
+    Profile::Timer searchTimer(Profile::CANDIDATE_SEARCH);
+    if (this->useCoveringCandidates) {
+      std::vector<S2CellIndex::Label>& candidates = this->coveringCandidates[i];
+      mightIntersectIndices.assign(candidates.begin(), candidates.end());
+      std::vector<S2CellIndex::Label>().swap(candidates);
+    } else {
+      std::shared_ptr<const S2CellUnion> covering = featureCovering(
+        feature.get(),
+        this->maxFeatureCells,
+        this->anyCachedCovering
+      );
+      std::unordered_set<R_xlen_t> candidates;
+      if (this->geog2File != nullptr) {
+        candidates = findPossibleIntersections(
+          *covering,
+          this->geog2File->Index(),
+          this->geog2File->ShapeFeatures()
+        );
+      } else if (this->geog2Features == nullptr) {
+        candidates = findPossibleIntersections(
+          *covering,
+          this->geog2Index.get(),
+          this->geog2IndexSource
+        );
+      } else {
+        candidates = findPossibleIntersections(
+          *covering,
+          this->geog2Features->Index(),
+          this->geog2Features->ShapeFeatures()
+        );
+      }
+
+      mightIntersectIndices.assign(candidates.begin(), candidates.end());
+    }
+    searchTimer.Stop();
+    Profile::Count(Profile::CANDIDATE, mightIntersectIndices.size());
 
     // loop through features from geog2 that might intersect feature
     // and build a list of indices that actually intersect (based on
@@ -237,14 +513,16 @@ public:
     // comparisons)
     std::vector<int> actuallyIntersectIndices;
     for (R_xlen_t j: mightIntersectIndices) {
-      SEXP item = this->geog2[j];
-      XPtr<Geography> feature2(item);
-      if (this->actuallyIntersects(index1, feature2->ShapeIndex(), i, j)) {
+      S2ShapeIndex* index2 = this->shapeIndex2(j);
+      Profile::Timer refinementTimer(Profile::REFINEMENT);
+      if (this->actuallyIntersects(index1, index2, i, j)) {
         // convert to R index here + 1
         actuallyIntersectIndices.push_back(j + 1);
       }
     }
 
+    Profile::Count(Profile::HIT, actuallyIntersectIndices.size());
+
     // return sorted integer vector
     std::sort(actuallyIntersectIndices.begin(), actuallyIntersectIndices.end());
     return Rcpp::IntegerVector(actuallyIntersectIndices.begin(), actuallyIntersectIndices.end());
@@ -252,14 +530,31 @@ public:
 
   virtual bool actuallyIntersects(S2ShapeIndex* index1, S2ShapeIndex* index2, R_xlen_t i, R_xlen_t j) = 0;
 
+  S2ShapeIndex* shapeIndex2(R_xlen_t j) {
+    if (this->geog2File != nullptr) {
+      return this->geog2FileFeatures->ShapeIndex(j);
+    } else if (this->geog2Features != nullptr) {
+      return this->geog2Features->Feature(j)->ShapeIndex();
+    }
+
+    SEXP item = this->geog2[j];
+    return XPtr<Geography>(checkGeographyPointer(item))->ShapeIndex();
+  }
+
   protected:
     List geog2;
+    std::unique_ptr<ShapeIndexFileFeatures> geog2FileFeatures;
     S2BooleanOperation::Options options;
     int maxFeatureCells;
+    bool anyCachedCovering;
+    int maxEdgesPerCell = 50;
+    bool canJoinCoverings = true;
+    bool useCoveringCandidates = false;
+    std::vector<std::vector<S2CellIndex::Label>> coveringCandidates;
 };
 
 // [[Rcpp::export]]
-List cpp_s2_may_intersect_matrix(List geog1, List geog2, 
+List cpp_s2_may_intersect_matrix(List geog1, SEXP geog2, 
                                  int maxEdgesPerCell, int maxFeatureCells, List s2options) {
   class Op: public IndexedMatrixPredicateOperator {
   public:
@@ -277,7 +572,7 @@ List cpp_s2_may_intersect_matrix(List geog1, List geog2,
 }
 
 // [[Rcpp::export]]
-List cpp_s2_contains_matrix(List geog1, List geog2, List s2options) {
+List cpp_s2_contains_matrix(List geog1, SEXP geog2, List s2options) {
   class Op: public IndexedMatrixPredicateOperator {
   public:
     Op(List s2options): IndexedMatrixPredicateOperator(s2options) {}
@@ -292,7 +587,7 @@ List cpp_s2_contains_matrix(List geog1, List geog2, List s2options) {
 }
 
 // [[Rcpp::export]]
-List cpp_s2_within_matrix(List geog1, List geog2, List s2options) {
+List cpp_s2_within_matrix(List geog1, SEXP geog2, List s2options) {
   class Op: public IndexedMatrixPredicateOperator {
   public:
     Op(List s2options): IndexedMatrixPredicateOperator(s2options) {}
@@ -308,7 +603,7 @@ List cpp_s2_within_matrix(List geog1, List geog2, List s2options) {
 }
 
 // [[Rcpp::export]]
-List cpp_s2_intersects_matrix(List geog1, List geog2, List s2options) {
+List cpp_s2_intersects_matrix(List geog1, SEXP geog2, List s2options) {
   class Op: public IndexedMatrixPredicateOperator {
   public:
     Op(List s2options): IndexedMatrixPredicateOperator(s2options) {}
@@ -323,7 +618,7 @@ List cpp_s2_intersects_matrix(List geog1, List geog2, List s2options) {
 }
 
 // [[Rcpp::export]]
-List cpp_s2_equals_matrix(List geog1, List geog2, List s2options) {
+List cpp_s2_equals_matrix(List geog1, SEXP geog2, List s2options) {
   class Op: public IndexedMatrixPredicateOperator {
   public:
     Op(List s2options): IndexedMatrixPredicateOperator(s2options) {}
@@ -338,7 +633,7 @@ List cpp_s2_equals_matrix(List geog1, List geog2, List s2options) {
 }
 
 // [[Rcpp::export]]
-List cpp_s2_touches_matrix(List geog1, List geog2, List s2options) {
+List cpp_s2_touches_matrix(List geog1, SEXP geog2, List s2options) {
   class Op: public IndexedMatrixPredicateOperator {
   public:
     Op(List s2options): IndexedMatrixPredicateOperator(s2options) {
@@ -367,6 +662,110 @@ List cpp_s2_touches_matrix(List geog1, List geog2, List s2options) {
   return op.processVector(geog1);
 }
 
+// [[Rcpp::export]]
+List cpp_s2_relate_matrix(List geog1, SEXP geog2, List s2options) {
+  // this doesn't fit IndexedMatrixPredicateOperator because it returns
+  // a relation code for each y index instead of a filtered set of y indices
+  class Op: public IndexedBinaryGeographyOperator<List, List> {
+  public:
+    Op(List s2options):
+      relation(GeographyOperationOptions(s2options).booleanOperationOptions()) {}
+
+    // geog2 can also be a feature index created by s2_feature_index(), in
+    // which case feature ids are returned instead of indices into geog2
+    void buildIndex(SEXP geog2) {
+      this->geog2Features = featureIndex(geog2);
+      if (this->geog2Features != nullptr) {
+        for (R_xlen_t featureId: this->geog2Features->FeatureIds()) {
+          if (this->geog2Features->Feature(featureId)->IsEmpty()) {
+            this->emptyIndices2.push_back(featureId);
+          }
+        }
+
+        return;
+      } else if (shapeIndexFile(geog2) != nullptr) {
+        Rcpp::stop("Can't use an index opened by s2_index_read() in s2_relate_matrix() (use s2_feature_index())");
+      }
+
+      this->geog2 = geog2;
+      IndexedBinaryGeographyOperator<List, List>::buildIndex(this->geog2);
+
+      // missing features in geog2 are an error when the index is built
+      for (R_xlen_t j = 0; j < this->geog2.size(); j++) {
+        if (this->feature2(j)->IsEmpty()) {
+          this->emptyIndices2.push_back(j);
+        }
+      }
+    }
+
+    List processFeature(Rcpp::XPtr<Geography> feature, R_xlen_t i) {
+      // empty features have no shapes in the index and are only related to
+      // other empty features (which they equal)
+      std::vector<R_xlen_t> candidates;
+      if (feature->IsEmpty()) {
+        candidates = this->emptyIndices2;
+      } else {
+        // see IndexedMatrixPredicateOperator for why 4 cells is the default
+        std::shared_ptr<const S2CellUnion> covering = featureCovering(feature.get(), 4);
+        std::unordered_set<R_xlen_t> mightIntersectIndices;
+        if (this->geog2Features == nullptr) {
+          mightIntersectIndices = findPossibleIntersections(
+            *covering,
+            this->geog2Index.get(),
+            this->geog2IndexSource
+          );
+        } else {
+          mightIntersectIndices = findPossibleIntersections(
+            *covering,
+            this->geog2Features->Index(),
+            this->geog2Features->ShapeFeatures()
+          );
+        }
+
+        candidates.assign(mightIntersectIndices.begin(), mightIntersectIndices.end());
+        std::sort(candidates.begin(), candidates.end());
+      }
+
+      // every relation except disjoint requires the closed boundaries to
+      // intersect (or both features to be empty), so pairs that aren't
+      // candidates can be omitted
+      std::vector<int> indices;
+      std::vector<int> relations;
+      for (R_xlen_t j: candidates) {
+        int relation = this->relation.relate(feature.get(), this->feature2(j));
+        if (relation != 0) {
+          // convert to R index here + 1
+          indices.push_back(j + 1);
+          relations.push_back(relation);
+        }
+      }
+
+      return List::create(
+        _["y"] = IntegerVector(indices.begin(), indices.end()),
+        _["relation"] = IntegerVector(relations.begin(), relations.end())
+      );
+    }
+
+  private:
+    List geog2;
+    std::vector<R_xlen_t> emptyIndices2;
+    GeographyRelation relation;
+
+    Geography* feature2(R_xlen_t j) {
+      if (this->geog2Features != nullptr) {
+        return this->geog2Features->Feature(j);
+      }
+
+      SEXP item = this->geog2[j];
+      return XPtr<Geography>(checkGeographyPointer(item)).get();
+    }
+  };
+
+  Op op(s2options);
+  op.buildIndex(geog2);
+  return op.processVector(geog1);
+}
+
 
 // ----------- brute force binary predicate operators ------------------
 
@@ -396,7 +795,7 @@ public:
       if (item1 ==  R_NilValue) {
         output[i] = R_NilValue;
       } else {
-        Rcpp::XPtr<Geography> feature1(item1);
+        Rcpp::XPtr<Geography> feature1(checkGeographyPointer(item1));
 
         for (size_t j = 0; j < geog2.size(); j++) {
           checkUserInterrupt();
@@ -405,7 +804,7 @@ public:
             stop("Missing `y` not allowed in binary index operations");
           }
 
-          XPtr<Geography> feature2(item2);
+          XPtr<Geography> feature2(checkGeographyPointer(item2));
 
           bool result = this->processFeature(feature1, feature2, i, j);
           if (result) {
@@ -420,6 +819,9 @@ public:
         }
         output[i] = itemOut;
       }
+
+      // indexes built for previous rows are no longer in use
+      ShapeIndexBudget::Global().Enforce();
     }
 
     return output;
@@ -430,7 +832,7 @@ public:
 };
 
 // [[Rcpp::export]]
-List cpp_s2_dwithin_matrix(List geog1, List geog2, double distance) {
+List cpp_s2_dwithin_matrix(List geog1, SEXP geog2, double distance) {
   class Op: public BruteForceMatrixPredicateOperator {
   public:
     double distance;
@@ -443,64 +845,169 @@ List cpp_s2_dwithin_matrix(List geog1, List geog2, double distance) {
     };
   };
 
+  // for an index opened by s2_index_read(), candidates are features in the
+  // file's index that intersect a covering of each feature buffered by
+  // distance, and are refined using indexes of their decoded shapes
+  class FileOp: public UnaryGeographyOperator<List, IntegerVector> {
+  public:
+    FileOp(ShapeIndexFile* file, double distance):
+      file(file), fileFeatures(file), distance(S1ChordAngle::Radians(distance)) {
+      // see IndexedMatrixPredicateOperator for why 4 cells is the default
+      this->coverer.mutable_options()->set_max_cells(4);
+    }
+
+    IntegerVector processFeature(XPtr<Geography> feature, R_xlen_t i) {
+      Profile::Timer searchTimer(Profile::CANDIDATE_SEARCH);
+      S2ShapeIndexBufferedRegion region(feature->ShapeIndex(), this->distance);
+      S2CellUnion covering = this->coverer.GetCovering(region);
+      std::unordered_set<R_xlen_t> candidates = findPossibleIntersections(
+        covering,
+        this->file->Index(),
+        this->file->ShapeFeatures()
+      );
+      searchTimer.Stop();
+      Profile::Count(Profile::CANDIDATE, candidates.size());
+
+      S2ClosestEdgeQuery::ShapeIndexTarget target(feature->ShapeIndex());
+      std::vector<int> indices;
+      for (R_xlen_t j: candidates) {
+        Profile::Timer refinementTimer(Profile::REFINEMENT);
+        S2ClosestEdgeQuery query(this->fileFeatures.ShapeIndex(j));
+        if (query.IsDistanceLessOrEqual(&target, this->distance)) {
+          // convert to R index here + 1
+          indices.push_back(j + 1);
+        }
+      }
+
+      Profile::Count(Profile::HIT, indices.size());
+      std::sort(indices.begin(), indices.end());
+      return IntegerVector(indices.begin(), indices.end());
+    }
+
+  private:
+    ShapeIndexFile* file;
+    ShapeIndexFileFeatures fileFeatures;
+    S1ChordAngle distance;
+    S2RegionCoverer coverer;
+  };
+
+  ShapeIndexFile* file = shapeIndexFile(geog2);
+  if (file != nullptr) {
+    FileOp op(file, distance);
+    return op.processVector(geog1);
+  }
+
   Op op(distance);
   return op.processVector(geog1, geog2);
 }
 
 // ----------- distance matrix operators -------------------
 
-template<class MatrixType, class ScalarType>
-class MatrixGeographyOperator {
+// Fills a distance matrix in parallel over rows of x (in blocks, so that
+// indexes built for earlier rows can be released between blocks when there
+// is a budget for them). Each row uses one query object for all of its
+// targets, and values are written directly to the output buffer (rows are
+// written by exactly one thread). When x and y contain the same features,
+// only the upper triangle is computed. Pairs of point geographies with few
+// points (e.g., single points) skip the index entirely and compare
+// S1ChordAngles between vertices directly. geog2 can also be an index opened
+// by s2_index_read(), in which case each column uses an index of the decoded
+// shapes of a feature in the file, built the first time any row needs it, or
+// a feature index, in which case there is a column for every feature id.
+template<class Query>
+class DistanceMatrixOperator {
 public:
-  MatrixType processVector(Rcpp::List geog1, Rcpp::List geog2) {
+  NumericMatrix processVector(List geog1, SEXP geog2, double maxError, int numThreads) {
+    std::vector<Geography*> features1 = geographyPointers(geog1);
+    std::vector<Geography*> features2;
+    std::unique_ptr<ShapeIndexFileFeatures> fileFeatures;
+
+    ShapeIndexFile* file = shapeIndexFile(geog2);
+    FeatureIndex* geog2Features = featureIndex(geog2);
+    if (file != nullptr) {
+      fileFeatures = absl::make_unique<ShapeIndexFileFeatures>(file);
+    } else if (geog2Features != nullptr) {
+      // columns are feature ids, including those of removed features
+      features2 = geog2Features->FeaturePointers();
+    } else {
+      features2 = geographyPointers(geog2);
+    }
 
-    MatrixType output(geog1.size(), geog2.size());
+    bool symmetric = file == nullptr && features1 == features2;
 
-    SEXP item1;
-    SEXP item2;
+    R_xlen_t nrow = features1.size();
+    R_xlen_t ncol = file != nullptr ? file->NumFeatures() : features2.size();
+    NumericMatrix output(nrow, ncol);
+    double* values = REAL(output);
+    S1ChordAngle maxErrorAngle = S1ChordAngle::Radians(maxError);
 
-    for (R_xlen_t i = 0; i < geog1.size(); i++) {
-      item1 = geog1[i];
-      if (item1 ==  R_NilValue) {
-        for (R_xlen_t j = 0; j < geog2.size(); j++) {
-          output(i, j) = MatrixType::get_na();
+    parallelForRows(nrow, [&](R_xlen_t i) {
+      R_xlen_t firstCol = symmetric ? i : 0;
+      Geography* feature1 = features1[i];
+
+      if (feature1 == nullptr) {
+        for (R_xlen_t j = firstCol; j < ncol; j++) {
+          values[i + j * nrow] = NA_REAL;
+          if (symmetric) {
+            values[j + i * nrow] = NA_REAL;
+          }
         }
-      } else {
-        Rcpp::XPtr<Geography> feature1(item1);
 
-        for (R_xlen_t j = 0; j < geog2.size(); j++) {
-          checkUserInterrupt();
-          item2 = geog2[j];
+        return;
+      }
 
-          if (item2 == R_NilValue) {
-            output(i, j) = MatrixType::get_na();
-          } else {
-            Rcpp::XPtr<Geography> feature2(item2);
-            output(i, j) = this->processFeature(feature1, feature2, i, j);
-          }
+      Query query(feature1->ShapeIndex());
+      query.mutable_options()->set_max_error(maxErrorAngle);
+
+      for (R_xlen_t j = firstCol; j < ncol; j++) {
+        if (file != nullptr) {
+          // missing features in the file have no shapes (and a distance of NA)
+          values[i + j * nrow] = this->distance(query, fileFeatures->ShapeIndex(j));
+          continue;
+        }
+
+        Geography* feature2 = features2[j];
+        double distance;
+
+        if (feature2 == nullptr) {
+          distance = NA_REAL;
+        } else if (usePointDistance(feature1, feature2)) {
+          distance = this->pointDistance(*feature1->Point(), *feature2->Point());
+        } else {
+          distance = this->distance(query, feature2->ShapeIndex());
+        }
+
+        values[i + j * nrow] = distance;
+        if (symmetric) {
+          values[j + i * nrow] = distance;
         }
       }
-    }
+    }, numThreads, 1);
 
     return output;
   }
 
-  virtual ScalarType processFeature(Rcpp::XPtr<Geography> feature1,
-                                    Rcpp::XPtr<Geography> feature2,
-                                    R_xlen_t i, R_xlen_t j) = 0;
+  // comparing every pair of points is quadratic, so pairs of larger
+  // multipoints use their indexes instead
+  static bool usePointDistance(Geography* feature1, Geography* feature2) {
+    const std::vector<S2Point>* points1 = feature1->Point();
+    const std::vector<S2Point>* points2 = feature2->Point();
+    return points1 != nullptr && points2 != nullptr &&
+      points1->size() * points2->size() <= 64;
+  }
+
+  virtual double distance(Query& query, S2ShapeIndex* index2) = 0;
+  virtual double pointDistance(const std::vector<S2Point>& points1,
+                               const std::vector<S2Point>& points2) = 0;
+  virtual ~DistanceMatrixOperator() {}
 };
 
 // [[Rcpp::export]]
-NumericMatrix cpp_s2_distance_matrix(List geog1, List geog2) {
-  class Op: public MatrixGeographyOperator<NumericMatrix, double> {
-
-    double processFeature(XPtr<Geography> feature1, XPtr<Geography> feature2,
-                          R_xlen_t i, R_xlen_t j) {
-      S2ClosestEdgeQuery query(feature1->ShapeIndex());
-      S2ClosestEdgeQuery::ShapeIndexTarget target(feature2->ShapeIndex());
-      const auto& result = query.FindClosestEdge(&target);
-
-      S1ChordAngle angle = result.distance();
+NumericMatrix cpp_s2_distance_matrix(List geog1, SEXP geog2, double maxError, int numThreads) {
+  class Op: public DistanceMatrixOperator<S2ClosestEdgeQuery> {
+  public:
+    double distance(S2ClosestEdgeQuery& query, S2ShapeIndex* index2) {
+      S1ChordAngle angle = edgeQueryDistance(query, index2);
       double distance = angle.ToAngle().radians();
 
       if (distance == R_PosInf) {
@@ -509,23 +1016,34 @@ NumericMatrix cpp_s2_distance_matrix(List geog1, List geog2) {
         return distance;
       }
     }
+
+    double pointDistance(const std::vector<S2Point>& points1,
+                         const std::vector<S2Point>& points2) {
+      if (points1.size() == 0 || points2.size() == 0) {
+        return NA_REAL;
+      }
+
+      S1ChordAngle minDistance = S1ChordAngle::Infinity();
+      for (const S2Point& point1: points1) {
+        for (const S2Point& point2: points2) {
+          minDistance = std::min(minDistance, S1ChordAngle(point1, point2));
+        }
+      }
+
+      return minDistance.ToAngle().radians();
+    }
   };
 
   Op op;
-  return op.processVector(geog1, geog2);
+  return op.processVector(geog1, geog2, maxError, numThreads);
 }
 
 // [[Rcpp::export]]
-NumericMatrix cpp_s2_max_distance_matrix(List geog1, List geog2) {
-  class Op: public MatrixGeographyOperator<NumericMatrix, double> {
-
-    double processFeature(XPtr<Geography> feature1, XPtr<Geography> feature2,
-                          R_xlen_t i, R_xlen_t j) {
-      S2FurthestEdgeQuery query(feature1->ShapeIndex());
-      S2FurthestEdgeQuery::ShapeIndexTarget target(feature2->ShapeIndex());
-      const auto& result = query.FindFurthestEdge(&target);
-
-      S1ChordAngle angle = result.distance();
+NumericMatrix cpp_s2_max_distance_matrix(List geog1, SEXP geog2, double maxError, int numThreads) {
+  class Op: public DistanceMatrixOperator<S2FurthestEdgeQuery> {
+  public:
+    double distance(S2FurthestEdgeQuery& query, S2ShapeIndex* index2) {
+      S1ChordAngle angle = edgeQueryDistance(query, index2);
       double distance = angle.ToAngle().radians();
 
       // returns -1 if one of the indexes is empty
@@ -537,13 +1055,28 @@ NumericMatrix cpp_s2_max_distance_matrix(List geog1, List geog2) {
         return distance;
       }
     }
+
+    double pointDistance(const std::vector<S2Point>& points1,
+                         const std::vector<S2Point>& points2) {
+      if (points1.size() == 0 || points2.size() == 0) {
+        return NA_REAL;
+      }
+
+      S1ChordAngle maxDistance = S1ChordAngle::Negative();
+      for (const S2Point& point1: points1) {
+        for (const S2Point& point2: points2) {
+          maxDistance = std::max(maxDistance, S1ChordAngle(point1, point2));
+        }
+      }
+
+      return maxDistance.ToAngle().radians();
+    }
   };
 
   Op op;
-  return op.processVector(geog1, geog2);
+  return op.processVector(geog1, geog2, maxError, numThreads);
 }
 
-
 // ----------- brute force binary predicate operators (for testing) ------------------
 
 // [[Rcpp::export]]
@@ -0,0 +1,141 @@
+
+#ifndef S2_PARALLEL_H
+#define S2_PARALLEL_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "geography.h"
+
+#include <Rcpp.h>
+
+// Calls fn(i) for i in [0, n) using up to numThreads threads. Work is
+// handed out in chunks of grainSize so that features that take a long
+// time to process (e.g., large polygons) don't leave other threads idle.
+// The calling thread also does work and checks for a user interrupt
+// between chunks. fn is called from threads other than the main thread
+// and must not use the R API (including Rcpp vectors and XPtrs); the first
+// exception thrown by fn is re-thrown on the calling thread after all
+// threads have finished.
+template <class Function>
+void parallelFor(R_xlen_t n, Function fn, int numThreads, R_xlen_t grainSize = 16) {
+  if (numThreads <= 1 || n <= grainSize) {
+    for (R_xlen_t i = 0; i < n; i++) {
+      if (i % grainSize == 0) {
+        Rcpp::checkUserInterrupt();
+      }
+
+      fn(i);
+    }
+
+    return;
+  }
+
+  std::atomic<R_xlen_t> nextChunk(0);
+  std::atomic<bool> abort(false);
+  std::exception_ptr error;
+  std::mutex errorMutex;
+
+  // process one chunk, returning false when there is no more work to do
+  auto processChunk = [&]() -> bool {
+    if (abort) {
+      return false;
+    }
+
+    R_xlen_t start = nextChunk.fetch_add(grainSize);
+    if (start >= n) {
+      return false;
+    }
+
+    R_xlen_t end = std::min<R_xlen_t>(n, start + grainSize);
+    try {
+      for (R_xlen_t i = start; i < end; i++) {
+        fn(i);
+      }
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(errorMutex);
+      if (!error) {
+        error = std::current_exception();
+      }
+
+      abort = true;
+      return false;
+    }
+
+    return true;
+  };
+
+  R_xlen_t numChunks = (n + grainSize - 1) / grainSize;
+  int numWorkers = std::min<R_xlen_t>(numThreads, numChunks) - 1;
+  std::vector<std::thread> workers;
+  for (int i = 0; i < numWorkers; i++) {
+    workers.emplace_back([&]() {
+      while (processChunk()) {}
+    });
+  }
+
+  try {
+    while (processChunk()) {
+      Rcpp::checkUserInterrupt();
+    }
+  } catch (...) {
+    // the user interrupt: workers have to be joined before the stack unwinds
+    abort = true;
+    for (std::thread& worker: workers) {
+      worker.join();
+    }
+
+    throw;
+  }
+
+  for (std::thread& worker: workers) {
+    worker.join();
+  }
+
+  if (error) {
+    std::rethrow_exception(error);
+  }
+}
+
+// Calls parallelFor() for blocks of rows of a matrix operator with
+// ShapeIndexBudget::Enforce() between blocks (when no thread is using an
+// index), so that indexes built lazily for earlier rows can be released
+// before all rows have been processed.
+template <class Function>
+void parallelForRows(R_xlen_t n, Function fn, int numThreads, R_xlen_t grainSize = 16) {
+  ShapeIndexBudget& budget = ShapeIndexBudget::Global();
+  if (budget.Budget() == 0) {
+    parallelFor(n, fn, numThreads, grainSize);
+    return;
+  }
+
+  R_xlen_t blockSize = std::max(numThreads, 1) * grainSize * 4;
+  for (R_xlen_t start = 0; start < n; start += blockSize) {
+    R_xlen_t end = std::min<R_xlen_t>(n, start + blockSize);
+    parallelFor(end - start, [&](R_xlen_t i) { fn(start + i); }, numThreads, grainSize);
+    budget.Enforce();
+  }
+}
+
+// The R API can't be used from worker threads (see parallelFor()), so operators
+// that run in parallel extract the features first (nullptr for missing features).
+inline std::vector<Geography*> geographyPointers(Rcpp::List geog) {
+  std::vector<Geography*> features(geog.size());
+  for (R_xlen_t i = 0; i < geog.size(); i++) {
+    SEXP item = geog[i];
+    if (item == R_NilValue) {
+      features[i] = nullptr;
+    } else {
+      Rcpp::XPtr<Geography> feature(checkGeographyPointer(item));
+      features[i] = feature.get();
+    }
+  }
+
+  return features;
+}
+
+#endif
@@ -0,0 +1,138 @@
+
+#ifndef S2_POINT_DISTANCE_H
+#define S2_POINT_DISTANCE_H
+
+#include <algorithm>
+#include <vector>
+
+#include "s2/s1chord_angle.h"
+#include "geography.h"
+
+#include <Rcpp.h>
+
+// Pairwise distances between geographies that contain exactly one point don't
+// need a MutableS2ShapeIndex or an S2ClosestEdgeQuery: the distance is the
+// S1ChordAngle between the two points. When every feature in both vectors is
+// a single point, PointDistanceKernel copies the coordinates into contiguous
+// x, y, and z arrays and computes squared chord lengths in a loop with no
+// branches or function calls, which compilers can vectorize with whatever
+// instruction set is available on the target platform.
+
+inline bool isSinglePoint(Geography* feature) {
+  const std::vector<S2Point>* points = feature->Point();
+  return points != nullptr && points->size() == 1;
+}
+
+// the equivalent of S1ChordAngle(point1, point2) for single-point geographies
+inline S1ChordAngle singlePointDistance(Geography* feature1, Geography* feature2) {
+  return S1ChordAngle((*feature1->Point())[0], (*feature2->Point())[0]);
+}
+
+class PointDistanceKernel {
+public:
+  // Returns false (and leaves the kernel empty) if any non-missing feature
+  // in geog1 or geog2 is not a single point. geog1 and geog2 must have the
+  // same length.
+  bool init(Rcpp::List geog1, Rcpp::List geog2) {
+    R_xlen_t n = geog1.size();
+    this->resize(n);
+
+    for (R_xlen_t i = 0; i < n; i++) {
+      SEXP item1 = geog1[i];
+      SEXP item2 = geog2[i];
+      if (item1 == R_NilValue || item2 == R_NilValue) {
+        this->isNA[i] = true;
+        continue;
+      }
+
+      Rcpp::XPtr<Geography> feature1(checkGeographyPointer(item1));
+      Rcpp::XPtr<Geography> feature2(checkGeographyPointer(item2));
+      if (!isSinglePoint(feature1.get()) || !isSinglePoint(feature2.get())) {
+        this->resize(0);
+        return false;
+      }
+
+      const S2Point& point1 = (*feature1->Point())[0];
+      const S2Point& point2 = (*feature2->Point())[0];
+      this->x1[i] = point1.x();
+      this->y1[i] = point1.y();
+      this->z1[i] = point1.z();
+      this->x2[i] = point2.x();
+      this->y2[i] = point2.y();
+      this->z2[i] = point2.z();
+    }
+
+    return true;
+  }
+
+  // squared chord lengths, capped at 4 like S1ChordAngle(x, y)
+  std::vector<double> length2() {
+    R_xlen_t n = this->isNA.size();
+    std::vector<double> result(n);
+    const double* x1 = this->x1.data();
+    const double* y1 = this->y1.data();
+    const double* z1 = this->z1.data();
+    const double* x2 = this->x2.data();
+    const double* y2 = this->y2.data();
+    const double* z2 = this->z2.data();
+    double* out = result.data();
+
+    for (R_xlen_t i = 0; i < n; i++) {
+      double dx = x1[i] - x2[i];
+      double dy = y1[i] - y2[i];
+      double dz = z1[i] - z2[i];
+      out[i] = std::min(4.0, dx * dx + dy * dy + dz * dz);
+    }
+
+    return result;
+  }
+
+  // distances in radians (NA for missing features)
+  Rcpp::NumericVector distance() {
+    std::vector<double> length2 = this->length2();
+    Rcpp::NumericVector output(length2.size());
+
+    for (size_t i = 0; i < length2.size(); i++) {
+      if (this->isNA[i]) {
+        output[i] = NA_REAL;
+      } else {
+        // the same calculation as S1ChordAngle::ToAngle()
+        output[i] = 2 * asin(0.5 * sqrt(length2[i]));
+      }
+    }
+
+    return output;
+  }
+
+  // distance is in radians and must be the same length as geog1 and geog2
+  Rcpp::LogicalVector dwithin(Rcpp::NumericVector distance) {
+    std::vector<double> length2 = this->length2();
+    Rcpp::LogicalVector output(length2.size());
+
+    for (size_t i = 0; i < length2.size(); i++) {
+      if (this->isNA[i]) {
+        output[i] = NA_LOGICAL;
+      } else {
+        output[i] = length2[i] <= S1ChordAngle::Radians(distance[i]).length2();
+      }
+    }
+
+    return output;
+  }
+
+private:
+  std::vector<double> x1, y1, z1, x2, y2, z2;
+  std::vector<bool> isNA;
+
+  void resize(R_xlen_t n) {
+    this->x1.assign(n, 0);
+    this->y1.assign(n, 0);
+    this->z1.assign(n, 0);
+    this->x2.assign(n, 0);
+    this->y2.assign(n, 0);
+    this->z2.assign(n, 0);
+    this->isNA.assign(n, false);
+  }
+};
+
+#endif
@@ -7,6 +7,8 @@
 #include "s2/s2builderutil_snap_functions.h"
 
 #include "geography-operator.h"
+#include "geography-relate.h"
+#include "s2-point-distance.h"
 #include "s2-options.h"
 
 #include <Rcpp.h>
@@ -119,18 +121,46 @@ LogicalVector cpp_s2_touches(List geog1, List geog2, List s2options) {
   return op.processVector(geog1, geog2);
 }
 
+// [[Rcpp::export]]
+IntegerVector cpp_s2_relate(List geog1, List geog2, List s2options) {
+  class Op: public BinaryGeographyOperator<IntegerVector, int> {
+  public:
+    GeographyRelation relation;
+
+    Op(List s2options):
+      relation(GeographyOperationOptions(s2options).booleanOperationOptions()) {}
+
+    int processFeature(XPtr<Geography> feature1, XPtr<Geography> feature2, R_xlen_t i) {
+      return this->relation.relate(feature1.get(), feature2.get());
+    }
+  };
+
+  Op op(s2options);
+  return op.processVector(geog1, geog2);
+}
+
 // [[Rcpp::export]]
 LogicalVector cpp_s2_dwithin(List geog1, List geog2, NumericVector distance) {
   if (distance.size() != geog1.size())  {
     stop("Incompatible lengths"); // #nocov
   }
 
+  PointDistanceKernel kernel;
+  if (kernel.init(geog1, geog2)) {
+    return kernel.dwithin(distance);
+  }
+
   class Op: public BinaryGeographyOperator<LogicalVector, int> {
   public:
     NumericVector distance;
     Op(NumericVector distance): distance(distance) {}
 
     int processFeature(XPtr<Geography> feature1, XPtr<Geography> feature2, R_xlen_t i) {
+      if (isSinglePoint(feature1.get()) && isSinglePoint(feature2.get())) {
+        S1ChordAngle limit = S1ChordAngle::Radians(this->distance[i]);
+        return singlePointDistance(feature1.get(), feature2.get()) <= limit;
+      }
+
       S2ClosestEdgeQuery query(feature1->ShapeIndex());
       S2ClosestEdgeQuery::ShapeIndexTarget target(feature2->ShapeIndex());
       return query.IsDistanceLessOrEqual(&target, S1ChordAngle::Radians(this->distance[i]));
@@ -0,0 +1,31 @@
+
+#include "s2-profile.h"
+
+#include <Rcpp.h>
+using namespace Rcpp;
+
+// [[Rcpp::export]]
+List cpp_s2_profile() {
+  CharacterVector stage(Profile::N_STAGES);
+  NumericVector count(Profile::N_STAGES);
+  NumericVector seconds(Profile::N_STAGES);
+
+  for (int i = 0; i < Profile::N_STAGES; i++) {
+    stage[i] = Profile::StageName(i);
+    count[i] = Profile::Counted(i);
+    seconds[i] = Profile::Seconds(i);
+  }
+
+  return List::create(
+    _["stage"] = stage,
+    _["count"] = count,
+    _["seconds"] = seconds,
+    _["enabled"] = Profile::Enabled()
+  );
+}
+
+// [[Rcpp::export]]
+void cpp_s2_profile_reset(bool enabled) {
+  Profile::Reset();
+  Profile::SetEnabled(enabled);
+}
@@ -0,0 +1,126 @@
+
+#ifndef S2_PROFILE_H
+#define S2_PROFILE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+// Counters and timers for the stages of the operations that tend to
+// dominate run time, exposed to R as s2_profile(). Profiling is off by
+// default, in which case each counter or timer costs one relaxed atomic
+// load. Counters can be updated from any thread.
+class Profile {
+public:
+  enum Stage {
+    // calls to the vectorized operators in geography-operator.h
+    OPERATOR,
+    // features (or pairs of features) processed by those operators
+    FEATURE,
+    // shape indexes built for a feature or for all features of `y`
+    INDEX_BUILD,
+    // coverings of features in `x` and the index lookups that find candidates
+    CANDIDATE_SEARCH,
+    // pairs of features that might be related according to the index
+    CANDIDATE,
+    // candidate pairs checked using the exact predicate
+    REFINEMENT,
+    // candidate pairs for which the exact predicate is true
+    HIT,
+    BOOLEAN_OPERATION,
+    BUILDER,
+    WKB_IMPORT,
+    N_STAGES
+  };
+
+  static const char* StageName(int stage) {
+    static const char* names[] = {
+      "operator", "feature", "index_build", "candidate_search", "candidate",
+      "refinement", "hit", "boolean_operation", "builder", "wkb_import"
+    };
+
+    return names[stage];
+  }
+
+  static bool Enabled() {
+    return Global().enabled.load(std::memory_order_relaxed);
+  }
+
+  static void SetEnabled(bool enabled) {
+    Global().enabled.store(enabled, std::memory_order_relaxed);
+  }
+
+  static void Reset() {
+    Global().clear();
+  }
+
+  static void Count(Stage stage, uint64_t n = 1) {
+    if (Enabled()) {
+      Global().counts[stage].fetch_add(n, std::memory_order_relaxed);
+    }
+  }
+
+  static uint64_t Counted(int stage) {
+    return Global().counts[stage].load(std::memory_order_relaxed);
+  }
+
+  static double Seconds(int stage) {
+    return Global().nanoseconds[stage].load(std::memory_order_relaxed) / 1e9;
+  }
+
+  // Counts one call to stage and adds the time until Stop() is called or the
+  // timer goes out of scope (including the time spent in nested stages).
+  class Timer {
+  public:
+    Timer(Stage stage): stage(stage), active(Profile::Enabled()) {
+      if (this->active) {
+        this->start = std::chrono::steady_clock::now();
+      }
+    }
+
+    ~Timer() {
+      this->Stop();
+    }
+
+    void Stop() {
+      if (this->active) {
+        auto elapsed = std::chrono::steady_clock::now() - this->start;
+        Profile& profile = Profile::Global();
+        profile.counts[this->stage].fetch_add(1, std::memory_order_relaxed);
+        profile.nanoseconds[this->stage].fetch_add(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count(),
+          std::memory_order_relaxed
+        );
+        this->active = false;
+      }
+    }
+
+  private:
+    Stage stage;
+    bool active;
+    std::chrono::steady_clock::time_point start;
+  };
+
+private:
+  Profile(): enabled(false) {
+    this->clear();
+  }
+
+  static Profile& Global() {
+    static Profile global;
+    return global;
+  }
+
+  void clear() {
+    for (int i = 0; i < N_STAGES; i++) {
+      this->counts[i].store(0, std::memory_order_relaxed);
+      this->nanoseconds[i].store(0, std::memory_order_relaxed);
+    }
+  }
+
+  std::atomic<bool> enabled;
+  std::atomic<uint64_t> counts[N_STAGES];
+  std::atomic<uint64_t> nanoseconds[N_STAGES];
+};
+
+#endif
@@ -0,0 +1,59 @@
+
+#include "s2-random.h"
+#include "s2-parallel.h"
+#include "point-geography.h"
+#include "polyline-geography.h"
+#include "polygon-geography.h"
+
+#include <Rcpp.h>
+using namespace Rcpp;
+
+// [[Rcpp::export]]
+List cpp_s2_random(int n, int dimension, int numVertices, double fractalDimension,
+                   int numClusters, double clusterRadius, double overlap, double size,
+                   int numThreads) {
+  FeatureGenerator::Options options;
+  options.dimension = static_cast<FeatureGenerator::Dimension>(dimension);
+  options.numVertices = numVertices;
+  options.fractalDimension = fractalDimension;
+  options.numClusters = numClusters;
+  options.clusterRadius = S1Angle::Radians(clusterRadius);
+  options.overlap = overlap;
+  options.size = size;
+
+  // all random numbers are drawn here (on the main thread) so that the
+  // result only depends on the RNG seed and not on numThreads
+  FeatureGenerator generator(n, options);
+
+  std::vector<std::unique_ptr<Geography>> features(n);
+  parallelFor(n, [&](R_xlen_t i) {
+    // generated features are valid, so the (expensive) debug checks are skipped
+    std::vector<S2Point> vertices = generator.Vertices(i);
+    switch (options.dimension) {
+    case FeatureGenerator::POINT:
+      features[i] = absl::make_unique<PointGeography>(vertices);
+      break;
+
+    case FeatureGenerator::POLYLINE: {
+      std::vector<std::unique_ptr<S2Polyline>> polylines;
+      polylines.push_back(absl::make_unique<S2Polyline>(vertices, S2Debug::DISABLE));
+      features[i] = absl::make_unique<PolylineGeography>(std::move(polylines));
+      break;
+    }
+
+    case FeatureGenerator::POLYGON: {
+      auto loop = absl::make_unique<S2Loop>(vertices, S2Debug::DISABLE);
+      auto polygon = absl::make_unique<S2Polygon>(std::move(loop), S2Debug::DISABLE);
+      features[i] = absl::make_unique<PolygonGeography>(std::move(polygon));
+      break;
+    }
+    }
+  }, numThreads, 256);
+
+  List output(n);
+  for (R_xlen_t i = 0; i < n; i++) {
+    output[i] = XPtr<Geography>(features[i].release());
+  }
+
+  return output;
+}
@@ -0,0 +1,241 @@
+
+#ifndef S2_RANDOM_H
+#define S2_RANDOM_H
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+#include "s2/r2.h"
+#include "s2/s2cap.h"
+#include "s2/s2cell.h"
+#include "s2/s2cell_id.h"
+#include "s2/s2loop.h"
+#include "s2/s2metrics.h"
+#include "s2/s2point.h"
+#include "s2/s2pointutil.h"
+#include "s2/s2testing.h"
+
+// Generates random points, polylines, and polygons for performance testing.
+// Polygons are fractals from S2Testing::Fractal and polylines are one side
+// of such a fractal, so that the number of vertices and the complexity of
+// the boundary can be controlled. Features are centered in distinct cells
+// (at a level chosen so that there is room for all of them) and scaled to
+// fit inside their cell, so that features don't intersect each other
+// unless they are placed on a vertex of another feature (see overlap).
+//
+// All random numbers are drawn in the constructor using S2Testing::rnd
+// (which is not thread-safe); Vertices() only uses the stored placements
+// and can be called from several threads at once.
+class FeatureGenerator {
+public:
+  enum Dimension {POINT = 0, POLYLINE = 1, POLYGON = 2};
+
+  struct Options {
+    Options(): dimension(POINT), numVertices(3), fractalDimension(std::log(4) / std::log(3)),
+      numClusters(0), clusterRadius(S1Angle::Zero()), overlap(0), size(1) {}
+
+    Dimension dimension;
+    // the approximate number of vertices of each polyline or polygon
+    int numVertices;
+    // the fractal dimension of the boundary in [1, 2)
+    double fractalDimension;
+    // the number of caps in which features are placed, or 0 to place features
+    // anywhere on the sphere
+    int numClusters;
+    // the radius of each cluster
+    S1Angle clusterRadius;
+    // the proportion of features that are placed on a vertex of another
+    // feature (and therefore intersect it)
+    double overlap;
+    // the size of each feature relative to the room available to it in (0, 1]
+    double size;
+  };
+
+  FeatureGenerator(size_t numFeatures, const Options& options): options(options) {
+    if (options.dimension != POINT) {
+      this->initTemplate();
+    } else {
+      this->vertexTemplate.push_back(R2Point(0, 0));
+    }
+
+    for (int i = 0; i < options.numClusters; i++) {
+      this->clusters.push_back(S2Cap(S2Testing::RandomPoint(), options.clusterRadius));
+    }
+
+    size_t numOverlapping = std::round(numFeatures * options.overlap);
+    size_t numDistinct = numFeatures - numOverlapping;
+    if (numDistinct == 0 && numFeatures > 0) {
+      // overlapping features need another feature to overlap
+      numDistinct = 1;
+      numOverlapping = numFeatures - 1;
+    }
+
+    this->placeDistinct(numDistinct);
+
+    // features placed on a vertex of a distinct feature
+    for (size_t i = 0; i < numOverlapping; i++) {
+      const Placement& other = this->placements[S2Testing::rnd.Uniform(numDistinct)];
+      const R2Point& vertex = this->vertexTemplate[S2Testing::rnd.Uniform(this->vertexTemplate.size())];
+      Placement placement;
+      placement.center = this->fromTemplate(other, vertex);
+      placement.angle = 2 * M_PI * S2Testing::rnd.RandDouble();
+      placement.radius = other.radius;
+      this->placements.push_back(placement);
+    }
+
+    // so that overlapping features aren't all at the end
+    for (size_t i = this->placements.size(); i > 1; i--) {
+      std::swap(this->placements[i - 1], this->placements[S2Testing::rnd.Uniform(i)]);
+    }
+  }
+
+  size_t NumFeatures() const {
+    return this->placements.size();
+  }
+
+  // The vertices of feature i: one point, an open chain of vertices, or
+  // the vertices of a counter-clockwise loop.
+  std::vector<S2Point> Vertices(size_t i) const {
+    const Placement& placement = this->placements[i];
+    std::vector<S2Point> vertices;
+    vertices.reserve(this->vertexTemplate.size());
+    for (const R2Point& vertex: this->vertexTemplate) {
+      vertices.push_back(this->fromTemplate(placement, vertex));
+    }
+
+    return vertices;
+  }
+
+private:
+  struct Placement {
+    S2Point center;
+    // the rotation of the template around center
+    double angle;
+    // the distance in the tangent plane at center corresponding to a
+    // distance of 1 in the template
+    double radius;
+  };
+
+  Options options;
+  std::vector<R2Point> vertexTemplate;
+  std::vector<S2Cap> clusters;
+  std::vector<Placement> placements;
+
+  // Every feature has the same shape, so the fractal is generated once in
+  // the tangent plane and rotated, scaled, and projected for each feature.
+  // The template is centered so that polylines pass through their center
+  // and scaled so that no vertex is further than 1 from the center.
+  void initTemplate() {
+    if (this->options.fractalDimension < 1 || this->options.fractalDimension >= 2) {
+      throw std::invalid_argument("fractal dimension must be in [1, 2)");
+    }
+
+    S2Testing::Fractal fractal;
+    fractal.set_fractal_dimension(this->options.fractalDimension);
+    if (this->options.dimension == POLYGON) {
+      fractal.SetLevelForApproxMaxEdges(std::max(3, this->options.numVertices));
+    } else {
+      // each side of the fractal has a third of its edges
+      fractal.SetLevelForApproxMaxEdges(3 * std::max(1, this->options.numVertices - 1));
+    }
+
+    std::unique_ptr<S2Loop> loop = fractal.MakeLoop(Matrix3x3_d::Identity(), S1Angle::Radians(1));
+    int numVertices = loop->num_vertices();
+    if (this->options.dimension == POLYLINE) {
+      numVertices = numVertices / 3 + 1;
+    }
+
+    for (int i = 0; i < numVertices; i++) {
+      const S2Point& vertex = loop->vertex(i);
+      this->vertexTemplate.push_back(R2Point(vertex.x() / vertex.z(), vertex.y() / vertex.z()));
+    }
+
+    if (this->options.dimension == POLYLINE) {
+      R2Point middle = this->vertexTemplate[numVertices / 2];
+      for (R2Point& vertex: this->vertexTemplate) {
+        vertex -= middle;
+      }
+    }
+
+    double extent = 0;
+    for (const R2Point& vertex: this->vertexTemplate) {
+      extent = std::max(extent, vertex.Norm());
+    }
+
+    for (R2Point& vertex: this->vertexTemplate) {
+      vertex /= extent;
+    }
+  }
+
+  S2Point samplePoint() const {
+    if (this->clusters.size() == 0) {
+      return S2Testing::RandomPoint();
+    } else {
+      return S2Testing::SamplePoint(this->clusters[S2Testing::rnd.Uniform(this->clusters.size())]);
+    }
+  }
+
+  // Places each feature at the center of a distinct cell with room for
+  // about four times as many features as are placed. Points are placed
+  // anywhere in the clusters because they can't intersect each other.
+  void placeDistinct(size_t numDistinct) {
+    if (this->options.dimension == POINT) {
+      for (size_t i = 0; i < numDistinct; i++) {
+        this->placements.push_back({this->samplePoint(), 0, 0});
+      }
+
+      return;
+    }
+
+    double area = 4 * M_PI;
+    if (this->clusters.size() > 0) {
+      area = std::min(area, this->clusters.size() * this->clusters[0].GetArea());
+    }
+
+    int level = S2::kAvgArea.GetLevelForMaxValue(area / (4.0 * numDistinct));
+
+    std::unordered_set<uint64> used;
+    size_t attempts = 0;
+    while (this->placements.size() < numDistinct) {
+      // clusters that overlap each other may have fewer cells than expected
+      if (attempts++ > 16 * numDistinct + 1024) {
+        if (level == S2CellId::kMaxLevel) {
+          throw std::runtime_error("Can't find a distinct cell for each feature");
+        }
+
+        level++;
+        attempts = 0;
+        used.clear();
+        this->placements.clear();
+      }
+
+      S2CellId cellId = S2CellId(this->samplePoint()).parent(level);
+      if (!used.insert(cellId.id()).second) {
+        continue;
+      }
+
+      // edges are geodesics, so a feature whose vertices are closer to the
+      // center than the cell boundary is inside the cell
+      Placement placement;
+      placement.center = cellId.ToPoint();
+      double room = S2Cell(cellId).GetBoundaryDistance(placement.center).ToAngle().radians();
+      placement.angle = 2 * M_PI * S2Testing::rnd.RandDouble();
+      placement.radius = std::tan(room * this->options.size);
+      this->placements.push_back(placement);
+    }
+  }
+
+  S2Point fromTemplate(const Placement& placement, const R2Point& vertex) const {
+    const S2Point& z = placement.center;
+    S2Point a = S2::Ortho(z);
+    S2Point b = z.CrossProd(a);
+    S2Point x = std::cos(placement.angle) * a + std::sin(placement.angle) * b;
+    S2Point y = std::cos(placement.angle) * b - std::sin(placement.angle) * a;
+    return (z + placement.radius * (vertex.x() * x + vertex.y() * y)).Normalize();
+  }
+};
+
+#endif
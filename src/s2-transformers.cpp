@@ -16,6 +16,7 @@
 #include "s2/s2region_coverer.h"
 
 #include "s2-options.h"
+#include "s2-profile.h"
 #include "geography-operator.h"
 #include "point-geography.h"
 #include "polyline-geography.h"
@@ -76,6 +77,7 @@ std::unique_ptr<Geography> doBooleanOperation(S2ShapeIndex* index1, S2ShapeIndex
                                               S2BooleanOperation::OpType opType,
                                               S2BooleanOperation::Options options,
                                               GeographyOperationOptions::LayerOptions layerOptions) {
+  Profile::Timer timer(Profile::BOOLEAN_OPERATION);
 
   // create the data structures that will contain the output
   std::vector<S2Point> points;
@@ -114,6 +116,8 @@ std::unique_ptr<Geography> doBooleanOperation(S2ShapeIndex* index1, S2ShapeIndex
 std::unique_ptr<Geography> rebuildGeography(S2ShapeIndex* index,
                                             S2Builder::Options options,
                                             GeographyOperationOptions::LayerOptions layerOptions) {
+  Profile::Timer timer(Profile::BUILDER);
+
   // create the builder
   S2Builder builder(options);
 
@@ -229,7 +233,7 @@ List cpp_s2_coverage_union_agg(List geog, List s2options, bool naRm) {
     }
 
     if (item != R_NilValue) {
-      Rcpp::XPtr<Geography> feature(item);
+      Rcpp::XPtr<Geography> feature(checkGeographyPointer(item));
       feature->BuildShapeIndex(&index);
     }
   }
@@ -269,7 +273,7 @@ List cpp_s2_union_agg(List geog, List s2options, bool naRm) {
     }
 
     if (item != R_NilValue) {
-      Rcpp::XPtr<Geography> feature(item);
+      Rcpp::XPtr<Geography> feature(checkGeographyPointer(item));
 
       index->Clear();
       s2builderutil::LayerVector layers(3);
@@ -313,7 +317,7 @@ List cpp_s2_centroid_agg(List geog, bool naRm) {
     }
 
     if (item != R_NilValue) {
-      Rcpp::XPtr<Geography> feature(item);
+      Rcpp::XPtr<Geography> feature(checkGeographyPointer(item));
       S2Point centroid = feature->Centroid();
       if (centroid.Norm2() > 0) {
         cumCentroid += centroid.Normalize();
@@ -344,7 +348,7 @@ List cpp_s2_rebuild_agg(List geog, List s2options, bool naRm) {
     }
 
     if (item != R_NilValue) {
-      Rcpp::XPtr<Geography> feature(item);
+      Rcpp::XPtr<Geography> feature(checkGeographyPointer(item));
       feature->BuildShapeIndex(&index);
     }
   }
@@ -517,9 +521,11 @@ List cpp_s2_unary_union(List geog, List s2options) {
 
       // valid polygons that are not part of a collection can also use a
       // simple union (common)
-      if (feature->GeographyType() == Geography::Type::GEOGRAPHY_POLYGON) {
+      bool isPolygon = feature->GeographyType() == Geography::Type::GEOGRAPHY_POLYGON;
+      DecodedGeography decoded(feature.get(), isPolygon);
+      if (isPolygon) {
         S2Error validationError;
-        if(!(feature->Polygon()->FindValidationError(&validationError))) {
+        if(!(decoded->Polygon()->FindValidationError(&validationError))) {
           simpleUnionOK = true;
         }
       }
@@ -541,7 +547,7 @@ List cpp_s2_unary_union(List geog, List s2options) {
         // invalid loops won't work with the S2BooleanOperation we will use to accumulate
         // (i.e., union) valid polygons, so we need to rebuild each loop as its own polygon,
         // splitting crossed edges along the way.
-        const S2Polygon* originalPoly = feature->Polygon();
+        const S2Polygon* originalPoly = decoded->Polygon();
 
         // Not exposing these options as an argument (except snap function)
         // because a particular combiation of them is required for this to work
@@ -628,7 +634,8 @@ List cpp_s2_interpolate_normalized(List geog, NumericVector distanceNormalized)
       }
 
       if (feature->GeographyType() == Geography::Type::GEOGRAPHY_POLYLINE) {
-        S2Point point = feature->Polyline()->at(0)->Interpolate(this->distanceNormalized[i]);
+        DecodedGeography polyline(feature.get());
+        S2Point point = polyline->Polyline()->at(0)->Interpolate(this->distanceNormalized[i]);
         return XPtr<PointGeography>(new PointGeography(point));
       } else {
         throw GeographyOperatorException("`x` must be a polyline geography");
@@ -20,6 +20,7 @@
 #include <algorithm>
 #include <atomic>
 #include <cmath>
+#include <thread>
 
 #include "s2/base/casts.h"
 #include "s2/base/commandlineflags.h"
@@ -109,7 +110,8 @@ const double MutableS2ShapeIndex::kCellPadding =
     2 * (S2::kFaceClipErrorUVCoord + S2::kEdgeClipErrorUVCoord);
 
 MutableS2ShapeIndex::Options::Options()
-    : max_edges_per_cell_(FLAGS_s2shape_index_default_max_edges_per_cell) {
+    : max_edges_per_cell_(FLAGS_s2shape_index_default_max_edges_per_cell),
+      num_threads_(1) {
 }
 
 void MutableS2ShapeIndex::Options::set_max_edges_per_cell(
@@ -117,6 +119,10 @@ void MutableS2ShapeIndex::Options::set_max_edges_per_cell(
   max_edges_per_cell_ = max_edges_per_cell;
 }
 
+void MutableS2ShapeIndex::Options::set_num_threads(int num_threads) {
+  num_threads_ = std::max(num_threads, 1);
+}
+
 bool MutableS2ShapeIndex::Iterator::Locate(const S2Point& target) {
   return LocateImpl(target, this);
 }
@@ -353,6 +359,11 @@ class MutableS2ShapeIndex::InteriorTracker {
   // only affects the state for shape_ids below "limit_shape_id".
   void RestoreStateBefore(int32 limit_shape_id);
 
+  // Sets the focus and the set of shapes that contain it to those of
+  // "other", which must not have any saved state.  (InteriorTracker can't be
+  // copied directly because "crosser_" refers to its own "a_" and "b_".)
+  void CopyStateFrom(const InteriorTracker& other);
+
  private:
   // Removes "shape_id" from shape_ids_ if it exists, otherwise insert it.
   void ToggleShape(int shape_id);
@@ -454,6 +465,15 @@ void MutableS2ShapeIndex::InteriorTracker::RestoreStateBefore(
   saved_ids_.clear();
 }
 
+void MutableS2ShapeIndex::InteriorTracker::CopyStateFrom(
+    const InteriorTracker& other) {
+  S2_DCHECK(other.saved_ids_.empty());
+  is_active_ = other.is_active_;
+  b_ = other.b_;
+  next_cellid_ = other.next_cellid_;
+  shape_ids_ = other.shape_ids_;
+}
+
 // Apply any pending updates in a thread-safe way.
 void MutableS2ShapeIndex::ApplyUpdatesThreadSafe() {
   lock_.Lock();
@@ -565,10 +585,14 @@ void MutableS2ShapeIndex::ApplyUpdatesInternal() {
     for (int id = pending_additions_begin_; id < batch.additions_end; ++id) {
       AddShape(id, all_edges, &tracker);
     }
-    for (int face = 0; face < 6; ++face) {
-      UpdateFaceEdges(face, all_edges[face], &tracker);
-      // Save memory by clearing vectors after we are done with them.
-      vector<FaceEdge>().swap(all_edges[face]);
+    if (options_.num_threads() > 1) {
+      UpdateFaceEdgesParallel(all_edges, &tracker);
+    } else {
+      for (int face = 0; face < 6; ++face) {
+        UpdateFaceEdges(face, all_edges[face], &tracker);
+        // Save memory by clearing vectors after we are done with them.
+        vector<FaceEdge>().swap(all_edges[face]);
+      }
     }
     pending_additions_begin_ = batch.additions_end;
   }
@@ -1008,16 +1032,220 @@ void MutableS2ShapeIndex::SkipCellRange(S2CellId begin, S2CellId end,
   }
 }
 
+// The index cells created and absorbed while updating one range of the
+// S2CellId space-filling curve on a worker thread.  Since cell_map_ can't be
+// modified concurrently, these are applied once all ranges have been updated.
+struct MutableS2ShapeIndex::CellUpdates {
+  vector<S2CellId> absorbed;
+  vector<std::pair<S2CellId, S2ShapeIndexCell*>> added;
+};
+
+// A cell that is updated independently of all other cells by
+// UpdateFaceEdgesParallel(), along with the InteriorTracker state at the
+// point where the space-filling curve enters the cell.
+struct MutableS2ShapeIndex::UpdateTask {
+  UpdateTask(const S2PaddedCell& _pcell,
+             const vector<const ClippedEdge*>& _edges,
+             bool _disjoint_from_index)
+      : pcell(_pcell), edges(_edges),
+        disjoint_from_index(_disjoint_from_index) {
+  }
+
+  S2PaddedCell pcell;
+  vector<const ClippedEdge*> edges;
+  bool disjoint_from_index;
+  InteriorTracker tracker;
+  CellUpdates updates;
+};
+
+// Like calling UpdateFaceEdges() for each face, except that the faces (and
+// cells within each face that contain many edges) are updated concurrently
+// using options_.num_threads() threads.  The result is identical to the
+// sequential update because (1) cells are divided exactly as UpdateEdges()
+// would divide them, (2) the InteriorTracker state at the start of each cell
+// is computed beforehand by drawing the path of the space-filling curve
+// through each cell in order, and (3) the index cells created or absorbed
+// while updating each cell don't affect the updates of any other cell.
+void MutableS2ShapeIndex::UpdateFaceEdgesParallel(vector<FaceEdge> all_edges[6],
+                                                  InteriorTracker* tracker) {
+  int num_threads = options_.num_threads();
+  size_t num_edges = 0;
+  for (int face = 0; face < 6; ++face) {
+    num_edges += all_edges[face].size();
+  }
+
+  // Cells are divided until they have at most "max_task_edges" edges (or
+  // would not be divided by UpdateEdges()), which gives each thread several
+  // tasks so that the work is balanced even when most edges are on one face.
+  size_t max_task_edges = max<size_t>(options_.max_edges_per_cell(),
+                                      num_edges / (8 * num_threads));
+
+  // As in UpdateFaceEdges(), create the initial ClippedEdge for each FaceEdge.
+  // These (and the edges clipped while dividing cells) are shared by all tasks.
+  vector<ClippedEdge> clipped_edge_storage[6];
+  EdgeAllocator alloc;
+  vector<unique_ptr<UpdateTask>> tasks;
+  bool disjoint_from_index = is_first_update();
+  for (int face = 0; face < 6; ++face) {
+    const vector<FaceEdge>& face_edges = all_edges[face];
+    int face_num_edges = face_edges.size();
+    vector<const ClippedEdge*> clipped_edges;
+    clipped_edge_storage[face].reserve(face_num_edges);
+    clipped_edges.reserve(face_num_edges);
+    R2Rect bound = R2Rect::Empty();
+    for (int e = 0; e < face_num_edges; ++e) {
+      ClippedEdge clipped;
+      clipped.face_edge = &face_edges[e];
+      clipped.bound = R2Rect::FromPointPair(face_edges[e].a, face_edges[e].b);
+      clipped_edge_storage[face].push_back(clipped);
+      clipped_edges.push_back(&clipped_edge_storage[face].back());
+      bound.AddRect(clipped.bound);
+    }
+
+    S2CellId face_id = S2CellId::FromFace(face);
+    S2PaddedCell pcell(face_id, kCellPadding);
+    if (face_num_edges > 0) {
+      S2CellId shrunk_id = ShrinkToFit(pcell, bound);
+      if (shrunk_id != pcell.id()) {
+        AddSkippedCellTasks(face_id.range_min(), shrunk_id.range_min(),
+                            disjoint_from_index, &tasks);
+        AddUpdateTasks(S2PaddedCell(shrunk_id, kCellPadding), clipped_edges,
+                       max_task_edges, &alloc, disjoint_from_index, &tasks);
+        AddSkippedCellTasks(shrunk_id.range_max().next(),
+                            face_id.range_max().next(), disjoint_from_index,
+                            &tasks);
+        continue;
+      }
+    }
+    AddUpdateTasks(pcell, clipped_edges, max_task_edges, &alloc,
+                   disjoint_from_index, &tasks);
+  }
+
+  // Compute the InteriorTracker state at the entry vertex of each task cell
+  // by drawing the path of the space-filling curve through the cell (which
+  // lies within the cell, since cells are convex in (u,v)-space and straight
+  // lines in (u,v)-space are geodesics).  Shapes being added and removed are
+  // tracked exactly as UpdateEdges() tracks them outside of absorbed cells.
+  for (const auto& task : tasks) {
+    task->tracker.CopyStateFrom(*tracker);
+    if (!tracker->is_active()) continue;
+    if (!tracker->at_cellid(task->pcell.id())) {
+      tracker->MoveTo(task->pcell.GetEntryVertex());
+    }
+    tracker->DrawTo(task->pcell.GetExitVertex());
+    TestAllEdges(task->edges, tracker);
+    tracker->set_next_cellid(task->pcell.id().next());
+  }
+
+  // Update the cells, giving each thread the next task that hasn't been
+  // started yet.
+  std::atomic<size_t> next_task(0);
+  auto update_tasks = [this, &tasks, &next_task]() {
+    size_t i;
+    while ((i = next_task.fetch_add(1)) < tasks.size()) {
+      UpdateTask* task = tasks[i].get();
+      if (task->edges.empty() && task->tracker.shape_ids().empty()) continue;
+      EdgeAllocator task_alloc;
+      UpdateEdges(task->pcell, &task->edges, &task->tracker, &task_alloc,
+                  task->disjoint_from_index, &task->updates);
+    }
+  };
+  vector<std::thread> threads;
+  int num_workers = std::min<size_t>(num_threads, tasks.size());
+  for (int t = 1; t < num_workers; ++t) {
+    threads.emplace_back(update_tasks);
+  }
+  update_tasks();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  // Cells are absorbed before new cells are added since a new cell may have
+  // the same id as an absorbed cell.  Tasks are in S2CellId order, so during
+  // initial construction of the index all insertions happen at the end.
+  for (const auto& task : tasks) {
+    for (S2CellId id : task->updates.absorbed) {
+      CellMap::iterator cell = cell_map_.find(id);
+      delete cell->second;
+      cell_map_.erase(cell);
+    }
+  }
+  for (const auto& task : tasks) {
+    for (const auto& cell : task->updates.added) {
+      cell_map_.insert(cell_map_.end(), cell);
+    }
+  }
+}
+
+// Adds a task with no edges for each cell in the given range.  (These cells
+// only need index entries if they are in the interior of at least one shape,
+// which is not known until the InteriorTracker state has been computed.)
+void MutableS2ShapeIndex::AddSkippedCellTasks(
+    S2CellId begin, S2CellId end, bool disjoint_from_index,
+    vector<unique_ptr<UpdateTask>>* tasks) const {
+  vector<const ClippedEdge*> no_edges;
+  for (S2CellId skipped_id : S2CellUnion::FromBeginEnd(begin, end)) {
+    tasks->push_back(absl::make_unique<UpdateTask>(
+        S2PaddedCell(skipped_id, kCellPadding), no_edges,
+        disjoint_from_index));
+  }
+}
+
+// Divides "pcell" into tasks with at most "max_task_edges" edges, following
+// the same decisions as UpdateEdges() so that each task cell is a cell that
+// UpdateEdges() would have visited.  A cell that UpdateEdges() would not
+// subdivide (including a cell that it would absorb) always becomes a task.
+void MutableS2ShapeIndex::AddUpdateTasks(
+    const S2PaddedCell& pcell, const vector<const ClippedEdge*>& edges,
+    size_t max_task_edges, EdgeAllocator* alloc, bool disjoint_from_index,
+    vector<unique_ptr<UpdateTask>>* tasks) const {
+  if (edges.size() > max_task_edges) {
+    bool subdivide = true;
+    bool child_disjoint_from_index = disjoint_from_index;
+    if (!disjoint_from_index) {
+      Iterator iter;
+      iter.InitStale(this);
+      CellRelation r = iter.Locate(pcell.id());
+      if (r == DISJOINT) {
+        child_disjoint_from_index = true;
+      } else if (r == INDEXED) {
+        subdivide = false;
+      }
+    }
+    if (subdivide && child_disjoint_from_index) {
+      subdivide = !FitsInIndexCell(pcell, edges);
+    }
+
+    if (subdivide) {
+      vector<const ClippedEdge*> child_edges[2][2];  // [i][j]
+      ClipChildEdges(pcell, edges, child_edges, alloc);
+      for (int pos = 0; pos < 4; ++pos) {
+        int i, j;
+        pcell.GetChildIJ(pos, &i, &j);
+        AddUpdateTasks(S2PaddedCell(pcell, i, j), child_edges[i][j],
+                       max_task_edges, alloc, child_disjoint_from_index, tasks);
+      }
+      return;
+    }
+  }
+
+  tasks->push_back(
+      absl::make_unique<UpdateTask>(pcell, edges, disjoint_from_index));
+}
+
 // Given a cell and a set of ClippedEdges whose bounding boxes intersect that
 // cell, add or remove all the edges from the index.  Temporary space for
 // edges that need to be subdivided is allocated from the given EdgeAllocator.
 // "disjoint_from_index" is an optimization hint indicating that cell_map_
-// does not contain any entries that overlap the given cell.
+// does not contain any entries that overlap the given cell.  If "updates" is
+// not nullptr, index cells are added to and absorbed from "updates" rather
+// than cell_map_ (see UpdateFaceEdgesParallel).
 void MutableS2ShapeIndex::UpdateEdges(const S2PaddedCell& pcell,
                                       vector<const ClippedEdge*>* edges,
                                       InteriorTracker* tracker,
                                       EdgeAllocator* alloc,
-                                      bool disjoint_from_index) {
+                                      bool disjoint_from_index,
+                                      CellUpdates* updates) {
   // Cases where an index cell is not needed should be detected before this.
   S2_DCHECK(!edges->empty() || !tracker->shape_ids().empty());
 
@@ -1057,7 +1285,7 @@ void MutableS2ShapeIndex::UpdateEdges(const S2PaddedCell& pcell,
     } else if (r == INDEXED) {
       // Absorb the index cell by transferring its contents to "edges" and
       // deleting it.  We also start tracking the interior of any new shapes.
-      AbsorbIndexCell(pcell, iter, edges, tracker, alloc);
+      AbsorbIndexCell(pcell, iter, edges, tracker, alloc, updates);
       index_cell_absorbed = true;
       disjoint_from_index = true;
     } else {
@@ -1069,7 +1297,8 @@ void MutableS2ShapeIndex::UpdateEdges(const S2PaddedCell& pcell,
   // subdividing so that we can merge with those cells.  Otherwise,
   // MakeIndexCell checks if the number of edges is small enough, and creates
   // an index cell if possible (returning true when it does so).
-  if (!disjoint_from_index || !MakeIndexCell(pcell, *edges, tracker)) {
+  if (!disjoint_from_index ||
+      !MakeIndexCell(pcell, *edges, tracker, updates)) {
     // Reserve space for the edges that will be passed to each child.  This is
     // important since otherwise the running time is dominated by the time
     // required to grow the vectors.  The amount of memory involved is
@@ -1086,42 +1315,8 @@ void MutableS2ShapeIndex::UpdateEdges(const S2PaddedCell& pcell,
     // edges that are allocated during edge splitting.
     size_t alloc_size = alloc->size();
 
-    // Compute the middle of the padded cell, defined as the rectangle in
-    // (u,v)-space that belongs to all four (padded) children.  By comparing
-    // against the four boundaries of "middle" we can determine which children
-    // each edge needs to be propagated to.
-    const R2Rect& middle = pcell.middle();
-
-    // Build up a vector edges to be passed to each child cell.  The (i,j)
-    // directions are left (i=0), right (i=1), lower (j=0), and upper (j=1).
-    // Note that the vast majority of edges are propagated to a single child.
-    // This case is very fast, consisting of between 2 and 4 floating-point
-    // comparisons and copying one pointer.  (ClipVAxis is inline.)
-    for (int e = 0; e < num_edges; ++e) {
-      const ClippedEdge* edge = (*edges)[e];
-      if (edge->bound[0].hi() <= middle[0].lo()) {
-        // Edge is entirely contained in the two left children.
-        ClipVAxis(edge, middle[1], child_edges[0], alloc);
-      } else if (edge->bound[0].lo() >= middle[0].hi()) {
-        // Edge is entirely contained in the two right children.
-        ClipVAxis(edge, middle[1], child_edges[1], alloc);
-      } else if (edge->bound[1].hi() <= middle[1].lo()) {
-        // Edge is entirely contained in the two lower children.
-        child_edges[0][0].push_back(ClipUBound(edge, 1, middle[0].hi(), alloc));
-        child_edges[1][0].push_back(ClipUBound(edge, 0, middle[0].lo(), alloc));
-      } else if (edge->bound[1].lo() >= middle[1].hi()) {
-        // Edge is entirely contained in the two upper children.
-        child_edges[0][1].push_back(ClipUBound(edge, 1, middle[0].hi(), alloc));
-        child_edges[1][1].push_back(ClipUBound(edge, 0, middle[0].lo(), alloc));
-      } else {
-        // The edge bound spans all four children.  The edge itself intersects
-        // either three or four (padded) children.
-        const ClippedEdge* left = ClipUBound(edge, 1, middle[0].hi(), alloc);
-        ClipVAxis(left, middle[1], child_edges[0], alloc);
-        const ClippedEdge* right = ClipUBound(edge, 0, middle[0].lo(), alloc);
-        ClipVAxis(right, middle[1], child_edges[1], alloc);
-      }
-    }
+    ClipChildEdges(pcell, *edges, child_edges, alloc);
+
     // Free any memory reserved for children that turned out to be empty.  This
     // step is cheap and reduces peak memory usage by about 10% when building
     // large indexes (> 10M edges).
@@ -1140,7 +1335,7 @@ void MutableS2ShapeIndex::UpdateEdges(const S2PaddedCell& pcell,
       pcell.GetChildIJ(pos, &i, &j);
       if (!child_edges[i][j].empty() || !tracker->shape_ids().empty()) {
         UpdateEdges(S2PaddedCell(pcell, i, j), &child_edges[i][j],
-                    tracker, alloc, disjoint_from_index);
+                    tracker, alloc, disjoint_from_index, updates);
       }
     }
     // Free any temporary edges that were allocated during clipping.
@@ -1152,6 +1347,51 @@ void MutableS2ShapeIndex::UpdateEdges(const S2PaddedCell& pcell,
   }
 }
 
+// Distribute the given edges among the four children of "pcell", clipping
+// any edge that spans more than one child.
+/* static */
+void MutableS2ShapeIndex::ClipChildEdges(
+    const S2PaddedCell& pcell, const vector<const ClippedEdge*>& edges,
+    vector<const ClippedEdge*> child_edges[2][2], EdgeAllocator* alloc) {
+  int num_edges = edges.size();
+  // Compute the middle of the padded cell, defined as the rectangle in
+  // (u,v)-space that belongs to all four (padded) children.  By comparing
+  // against the four boundaries of "middle" we can determine which children
+  // each edge needs to be propagated to.
+  const R2Rect& middle = pcell.middle();
+
+  // Build up a vector edges to be passed to each child cell.  The (i,j)
+  // directions are left (i=0), right (i=1), lower (j=0), and upper (j=1).
+  // Note that the vast majority of edges are propagated to a single child.
+  // This case is very fast, consisting of between 2 and 4 floating-point
+  // comparisons and copying one pointer.  (ClipVAxis is inline.)
+  for (int e = 0; e < num_edges; ++e) {
+    const ClippedEdge* edge = edges[e];
+    if (edge->bound[0].hi() <= middle[0].lo()) {
+      // Edge is entirely contained in the two left children.
+      ClipVAxis(edge, middle[1], child_edges[0], alloc);
+    } else if (edge->bound[0].lo() >= middle[0].hi()) {
+      // Edge is entirely contained in the two right children.
+      ClipVAxis(edge, middle[1], child_edges[1], alloc);
+    } else if (edge->bound[1].hi() <= middle[1].lo()) {
+      // Edge is entirely contained in the two lower children.
+      child_edges[0][0].push_back(ClipUBound(edge, 1, middle[0].hi(), alloc));
+      child_edges[1][0].push_back(ClipUBound(edge, 0, middle[0].lo(), alloc));
+    } else if (edge->bound[1].lo() >= middle[1].hi()) {
+      // Edge is entirely contained in the two upper children.
+      child_edges[0][1].push_back(ClipUBound(edge, 1, middle[0].hi(), alloc));
+      child_edges[1][1].push_back(ClipUBound(edge, 0, middle[0].lo(), alloc));
+    } else {
+      // The edge bound spans all four children.  The edge itself intersects
+      // either three or four (padded) children.
+      const ClippedEdge* left = ClipUBound(edge, 1, middle[0].hi(), alloc);
+      ClipVAxis(left, middle[1], child_edges[0], alloc);
+      const ClippedEdge* right = ClipUBound(edge, 0, middle[0].lo(), alloc);
+      ClipVAxis(right, middle[1], child_edges[1], alloc);
+    }
+  }
+}
+
 // Given an edge and an interval "middle" along the v-axis, clip the edge
 // against the boundaries of "middle" and add the edge to the corresponding
 // children.
@@ -1251,7 +1491,8 @@ void MutableS2ShapeIndex::AbsorbIndexCell(const S2PaddedCell& pcell,
                                           const Iterator& iter,
                                           vector<const ClippedEdge*>* edges,
                                           InteriorTracker* tracker,
-                                          EdgeAllocator* alloc) {
+                                          EdgeAllocator* alloc,
+                                          CellUpdates* updates) {
   S2_DCHECK_EQ(pcell.id(), iter.id());
 
   // When we absorb a cell, we erase all the edges that are being removed.
@@ -1356,15 +1597,34 @@ void MutableS2ShapeIndex::AbsorbIndexCell(const S2PaddedCell& pcell,
   }
   // Update the edge list and delete this cell from the index.
   edges->swap(new_edges);
-  cell_map_.erase(pcell.id());
-  delete &cell;
+  if (updates != nullptr) {
+    updates->absorbed.push_back(pcell.id());
+  } else {
+    cell_map_.erase(pcell.id());
+    delete &cell;
+  }
+}
+
+// Return true if the given edges are few enough to be stored in an index cell
+// at the level of "pcell", i.e. if the number of edges that have not reached
+// their maximum level yet is at most max_edges_per_cell().
+bool MutableS2ShapeIndex::FitsInIndexCell(
+    const S2PaddedCell& pcell, const vector<const ClippedEdge*>& edges) const {
+  int count = 0;
+  for (const ClippedEdge* edge : edges) {
+    count += (pcell.level() < edge->face_edge->max_level);
+    if (count > options_.max_edges_per_cell())
+      return false;
+  }
+  return true;
 }
 
 // Attempt to build an index cell containing the given edges, and return true
 // if successful.  (Otherwise the edges should be subdivided further.)
 bool MutableS2ShapeIndex::MakeIndexCell(const S2PaddedCell& pcell,
                                         const vector<const ClippedEdge*>& edges,
-                                        InteriorTracker* tracker) {
+                                        InteriorTracker* tracker,
+                                        CellUpdates* updates) {
   if (edges.empty() && tracker->shape_ids().empty()) {
     // No index cell is needed.  (In most cases this situation is detected
     // before we get to this point, but this can happen when all shapes in a
@@ -1372,14 +1632,7 @@ bool MutableS2ShapeIndex::MakeIndexCell(const S2PaddedCell& pcell,
     return true;
   }
 
-  // Count the number of edges that have not reached their maximum level yet.
-  // Return false if there are too many such edges.
-  int count = 0;
-  for (const ClippedEdge* edge : edges) {
-    count += (pcell.level() < edge->face_edge->max_level);
-    if (count > options_.max_edges_per_cell())
-      return false;
-  }
+  if (!FitsInIndexCell(pcell, edges)) return false;
 
   // Possible optimization: Continue subdividing as long as exactly one child
   // of "pcell" intersects the given edges.  This can be done by finding the
@@ -1462,7 +1715,11 @@ bool MutableS2ShapeIndex::MakeIndexCell(const S2PaddedCell& pcell,
   // is much faster to give an insertion hint in this case.  Otherwise the
   // hint doesn't do much harm.  With more effort we could provide a hint even
   // during incremental updates, but this is probably not worth the effort.
-  cell_map_.insert(cell_map_.end(), std::make_pair(pcell.id(), cell));
+  if (updates != nullptr) {
+    updates->added.push_back(std::make_pair(pcell.id(), cell));
+  } else {
+    cell_map_.insert(cell_map_.end(), std::make_pair(pcell.id(), cell));
+  }
 
   // Shift the InteriorTracker focus point to the exit vertex of this cell.
   if (tracker->is_active() && !edges.empty()) {
@@ -154,7 +154,7 @@ public:
     if (this->provider.featureIsNull()) {
       this->handler->nextNull(featureId);
     } else {
-      Rcpp::XPtr<Geography> geography(this->provider.feature());
+      Rcpp::XPtr<Geography> geography(checkGeographyPointer(this->provider.feature()));
       geography->Export(handler, WKReader::PART_ID_NONE);
     }
 